@@ -0,0 +1,103 @@
+#include "raha/core/ColorConvert.hpp"
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Compares ColorConverter kernels against swscale for 8-bit 4:2:0 -> BGRA at common sizes.
+// swscale runs without adjustments, so its numbers are a lower bound for an equivalent
+// filter-based pipeline.
+
+namespace {
+constexpr int iterations = 50;
+
+struct FrameDeleter {
+    void operator()(AVFrame* frame) const { av_frame_free(&frame); }
+};
+
+using FramePtr = std::unique_ptr<AVFrame, FrameDeleter>;
+
+FramePtr make_frame(int width, int height, AVPixelFormat format) {
+    FramePtr frame(av_frame_alloc());
+    frame->width = width;
+    frame->height = height;
+    frame->format = format;
+    if (av_frame_get_buffer(frame.get(), 0) < 0) {
+        return nullptr;
+    }
+    return frame;
+}
+
+void fill(AVFrame* frame) {
+    for (int plane = 0; plane < 3 && frame->data[plane]; ++plane) {
+        const int rows = plane == 0 ? frame->height : (frame->height + 1) / 2;
+        for (int row = 0; row < rows; ++row) {
+            uint8_t* line = frame->data[plane] + static_cast<std::ptrdiff_t>(row) * frame->linesize[plane];
+            for (int x = 0; x < frame->linesize[plane]; ++x) {
+                line[x] = static_cast<uint8_t>((x * 7 + row * 13 + plane * 61) & 0xFF);
+            }
+        }
+    }
+}
+
+double time_ms(const std::function<void()>& work) {
+    work();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        work();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+void run(int width, int height) {
+    FramePtr src = make_frame(width, height, AV_PIX_FMT_YUV420P);
+    FramePtr dst = make_frame(width, height, AV_PIX_FMT_BGRA);
+    if (!src || !dst) {
+        std::fprintf(stderr, "allocation failed for %dx%d\n", width, height);
+        return;
+    }
+    fill(src.get());
+    std::printf("%dx%d\n", width, height);
+
+    for (int flags : {SWS_FAST_BILINEAR, SWS_BILINEAR}) {
+        SwsContext* sws = sws_getContext(width, height, AV_PIX_FMT_YUV420P, width, height, AV_PIX_FMT_BGRA, flags, nullptr, nullptr, nullptr);
+        if (!sws) {
+            continue;
+        }
+        double ms = time_ms([&] { sws_scale_frame(sws, dst.get(), src.get()); });
+        std::printf("  swscale %-13s %8.3f ms\n", flags == SWS_BILINEAR ? "bilinear" : "fast_bilinear", ms);
+        sws_freeContext(sws);
+    }
+
+    raha::core::VideoAdjustments adjustments;
+    adjustments.brightness = 0.05F;
+    adjustments.contrast = 0.1F;
+    adjustments.saturation = 0.2F;
+    adjustments.gamma = 0.1F;
+    for (auto kernel : {raha::core::ColorKernel::Scalar, raha::core::ColorKernel::Sse2, raha::core::ColorKernel::Avx2}) {
+        raha::core::ColorConverter converter;
+        if (!converter.set_kernel(kernel)) {
+            std::printf("  %-21s unavailable\n", raha::core::to_string(kernel));
+            continue;
+        }
+        converter.configure(adjustments, AVCOL_SPC_BT709, AVCOL_RANGE_MPEG);
+        double ms = time_ms([&] { converter.convert(src.get(), dst->data[0], dst->linesize[0]); });
+        std::printf("  %-21s %8.3f ms\n", raha::core::to_string(kernel), ms);
+    }
+}
+
+} // namespace
+
+int main() {
+    std::printf("detected kernel: %s\n", raha::core::to_string(raha::core::detect_color_kernel()));
+    run(1920, 1080);
+    run(3840, 2160);
+    return 0;
+}
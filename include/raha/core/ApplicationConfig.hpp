@@ -1,16 +1,40 @@
 #pragma once
 
 #include <filesystem>
+#include <map>
 #include <optional>
 #include <string>
 #include <vector>
 
 namespace raha::core {
 
+// Which clock the others follow. Audio falls back to Video while there is no audio
+// output to measure.
+enum class SyncMode {
+    Audio,
+    Video,
+    External
+};
+
 struct PlaybackSettings {
     double playback_speed {1.0};
     bool loop_single {false};
     bool shuffle {false};
+    bool exact_seek {false}; // decode up to the requested time instead of stopping at the keyframe
+    // Frames further than this behind the clock are dropped before conversion.
+    bool drop_late_frames {true};
+    double late_frame_threshold {0.1};
+    // Nudge the playback clock (at most 0.5%) so frames last a whole number of vsyncs,
+    // e.g. 23.976 fps on a 24 Hz display. Only with a video master; audio is resampled
+    // to follow.
+    bool display_sync {false};
+    SyncMode sync_mode {SyncMode::Audio};
+    // Faster speeds decode keyframes only; above 4x they always do.
+    double trick_play_above_speed {2.0};
+    bool trick_play_audio {false}; // time-compress audio during trick play instead of muting it
+    // Decoded frames reverse playback may hold: the GOP playing and the one before it.
+    // GOPs that do not fit play back by their keyframe alone.
+    int reverse_buffer_mb {512};
 };
 
 struct VideoAdjustments {
@@ -21,11 +45,32 @@ struct VideoAdjustments {
     int aspect_ratio_mode {0};
 };
 
+// swresample filter length and interpolation when the device rate differs from the
+// stream's.
+enum class ResampleQuality {
+    Fast,
+    Balanced,
+    High
+};
+
+// How channels are folded when the device has fewer than the stream.
+enum class DownmixMode {
+    Normalized, // ITU levels, scaled so the mix cannot clip
+    Itu,        // centre and surrounds at -3 dB, LFE dropped; louder but may clip
+    Dialogue    // centre at full level and surrounds at -6 dB before normalizing
+};
+
 struct AudioSettings {
     float volume {1.0F};
     bool muted {false};
     float balance {0.0F};
-    double audio_delay {0.0};
+    double audio_delay {0.0}; // seconds; positive plays audio later than the video
+    int buffer_ms {200}; // decoded audio kept ahead of the device, 20-1000
+    ResampleQuality resample_quality {ResampleQuality::Balanced};
+    DownmixMode downmix {DownmixMode::Normalized};
+    // Small device periods and a ring target of a few periods instead of buffer_ms.
+    bool low_latency {false};
+    int period_frames {0}; // device buffer size; 0 picks 1024, or 256 in low-latency mode
 };
 
 struct SubtitleSettings {
@@ -42,12 +87,55 @@ struct NetworkSettings {
     bool sandbox_streams {true};
 };
 
+struct IoSettings {
+    bool memory_map_local_files {true};
+};
+
+struct RenderSettings {
+    // swscale threads by minimum source height; the entry with the largest height not
+    // above the frame's is used.
+    std::map<int, int> conversion_threads {{0, 1}, {1080, 2}, {2160, 4}};
+    // Convert and upload at the displayed size when the output is smaller than the video.
+    bool downscale_to_output {true};
+    // Output size changes younger than this do not reallocate textures yet.
+    int resize_cooldown_ms {250};
+    // Additionally ask the decoder for reduced-resolution output (lowres) when the
+    // reduction is at least 2x. Only a few codecs support it.
+    bool decoder_lowres {false};
+};
+
+enum class DecoderThreadType {
+    Auto,
+    Frame,
+    Slice
+};
+
+struct DecoderThreadingPolicy {
+    DecoderThreadType thread_type {DecoderThreadType::Auto};
+    int thread_count {0}; // 0 lets FFmpeg pick based on the available cores
+};
+
+struct DecoderSettings {
+    DecoderThreadingPolicy threading;
+    std::map<std::string, DecoderThreadingPolicy> codec_threading; // keyed by decoder name, e.g. "hevc"
+    bool huge_page_buffers {false};
+    // Skip deblocking while catching up to an exact seek target. Faster on long GOPs, but
+    // the target frame may show slight artifacts until the next keyframe.
+    bool seek_skip_loop_filter {true};
+    // Step video decoding down (loop filter, non-reference frames, lowres, keyframes only)
+    // while it cannot keep up with the frame rate.
+    bool adaptive_quality {true};
+};
+
 struct ApplicationConfig {
     PlaybackSettings playback;
     VideoAdjustments video_adjustments;
     AudioSettings audio;
     SubtitleSettings subtitles;
     NetworkSettings network;
+    IoSettings io;
+    DecoderSettings decoder;
+    RenderSettings render;
 
     std::optional<std::filesystem::path> last_media_path;
     std::optional<double> last_position_seconds;
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace raha::core {
+
+enum class AudioKernel {
+    Scalar,
+    Sse2
+};
+
+// SDL outputs at most 8 channels.
+constexpr int max_mix_channels = 8;
+
+using ChannelGains = std::array<float, max_mix_channels>;
+
+// Volume and balance as per-channel gains. Balance runs from -1 (left only) to 1 (right
+// only) and attenuates the first two channels, front left and right; it leaves the
+// others alone.
+[[nodiscard]] ChannelGains channel_gains(float volume, float balance, bool muted);
+[[nodiscard]] bool unity_gains(const ChannelGains& gains, int channels);
+
+// Writes `frames` interleaved frames of `channels` channels to `out`. Channel c is read
+// from inputs[c] every `input_stride` samples, so planar input (stride 1) is interleaved
+// and interleaved input (stride `channels`) is passed through; `out` may alias
+// interleaved input. Each channel's gain moves linearly from `start` to `end` across
+// the block, so volume and balance changes do not click.
+using MixFunction = void (*)(const float* const* inputs, std::size_t input_stride, int channels, std::size_t frames,
+                             const ChannelGains& start, const ChannelGains& end, float* out);
+
+[[nodiscard]] AudioKernel detect_audio_kernel();
+// Null when the kernel was not built for this target.
+[[nodiscard]] MixFunction mix_function(AudioKernel kernel);
+[[nodiscard]] const char* to_string(AudioKernel kernel);
+
+} // namespace raha::core
@@ -1,14 +1,26 @@
 #pragma once
 
+#include "raha/core/ApplicationConfig.hpp"
+#include "raha/core/AudioMix.hpp"
+#include "raha/core/AudioRingBuffer.hpp"
 #include "raha/core/DecoderBridge.hpp"
+#include "raha/core/TimeStretcher.hpp"
 
 extern "C" {
 #include <libswresample/swresample.h>
 }
 
 #include <SDL.h>
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 namespace raha::core {
 
@@ -20,34 +32,164 @@ struct SwrContextDeleter {
 
 using SwrContextPtr = std::unique_ptr<SwrContext, SwrContextDeleter>;
 
+struct AudioBufferStats {
+    uint64_t underruns {0}; // device callbacks that found the buffer short
+    uint64_t overruns {0};  // converted frames that did not fit completely
+    double fill_seconds {0.0};
+    StretchAlgorithm stretch {StretchAlgorithm::Bypass};
+    double stretch_load {0.0}; // fraction of a core the time-stretch needs in real time
+    double output_latency {0.0}; // seconds from the callback to the speaker, measured once settled
+    bool latency_measured {false}; // false while output_latency is still the two-period estimate
+    int period_frames {0};
+    int device_rate {0};
+    int device_channels {0};
+};
+
+// Pull-model audio output: the SDL device callback drains a lock-free ring buffer that a
+// refill thread keeps at AudioSettings::buffer_ms by pulling frames from the decoder.
+// Neither side depends on the UI thread. The device is opened at its native rate and
+// channel count, and a single swresample pass converts, resamples and downmixes to it.
 class AudioRenderer {
 public:
+    using FrameSource = std::function<std::optional<FramePtr>()>;
+
     AudioRenderer();
     ~AudioRenderer();
 
     AudioRenderer(const AudioRenderer&) = delete;
     AudioRenderer& operator=(const AudioRenderer&) = delete;
 
-    bool initialize(AVCodecContext* audio_ctx);
+    // Opens the device paused; `source` is called on the refill thread.
+    bool initialize(AVCodecContext* audio_ctx, const AudioSettings& settings, FrameSource source);
     void shutdown();
 
-    void queue_frame(const AVFrame* frame);
+    // Drops buffered audio, e.g. after a seek.
     void clear();
+    void set_paused(bool paused);
 
     void set_volume(float volume);
     void set_muted(bool muted);
+    void set_balance(float balance);
+    // Mutes output without touching the user's mute setting, e.g. during trick play.
+    void set_silenced(bool silenced);
+    [[nodiscard]] bool active() const { return device_ != 0; }
+    [[nodiscard]] double queued_seconds() const;
+    [[nodiscard]] AudioBufferStats stats() const;
+    // Media time of the sample leaving the speaker now: what the device has consumed,
+    // minus its output latency. The latency starts as an estimate of two periods and is
+    // replaced by a measurement a few seconds after the device opens. Nullopt until the
+    // device has played audio since the last clear or pause.
+    [[nodiscard]] std::optional<double> clock() const;
+    // Plays audio `rate` times faster by resampling, so it can follow another clock.
+    void set_resample_rate(double rate);
+    // Playback speed; audio is time-stretched to it, keeping its pitch.
+    void set_speed(double speed);
+    // Moves audio by `seconds` from the next decoded frame on: positive skips ahead by
+    // dropping samples, negative holds back by inserting silence.
+    void shift(double seconds);
     [[nodiscard]] float volume() const { return volume_; }
     [[nodiscard]] bool muted() const { return muted_; }
+    [[nodiscard]] float balance() const { return balance_; }
 
 private:
-    bool configure_device(const AVCodecContext* audio_ctx);
-    SwrContextPtr make_resampler(AVCodecContext* audio_ctx);
+    static void SDLCALL audio_callback(void* userdata, Uint8* stream, int len);
+
+    bool configure_device(const AVCodecContext* audio_ctx, const AudioSettings& settings);
+    SwrContextPtr make_resampler(const AVCodecContext* audio_ctx, const AudioSettings& settings);
+    // Called from the callback with the frames just handed to the device.
+    void measure_latency(std::size_t frames);
+    void refill_loop();
+    struct ClockAnchor {
+        std::size_t frame {0}; // ring position, in frames since the last clear
+        double pts {0.0};      // media time of the sample there
+        double speed {1.0};    // media seconds per played second from there on
+        double previous_speed {1.0}; // ... and before it
+    };
+
+    void write_frame(const AVFrame* frame);
+    // Converts without swresample when only interleaving is needed; returns the frames
+    // written to scratch_, or nullopt when the resampler has to run.
+    std::optional<std::size_t> convert_direct(const AVFrame* frame);
+    void write_output(const float* samples, std::size_t frames, std::optional<double> pts);
+    void write_silence(std::size_t frames);
+    void apply_compensation(const AVFrame* frame);
+    void publish_anchor(const ClockAnchor& anchor);
+    // The newest retained anchor at or before ring position `frame`, or the oldest one
+    // when they all lie after it.
+    [[nodiscard]] std::optional<ClockAnchor> load_anchor(std::size_t frame) const;
 
     SDL_AudioDeviceID device_ {0};
     SDL_AudioSpec obtained_spec_ {};
     SwrContextPtr resampler_;
+    FrameSource source_;
+    AudioRingBuffer ring_;
+    std::vector<float> scratch_;
+    double target_seconds_ {0.2};
+    AVChannelLayout device_layout_ {};
+    AVRational time_base_ {1, 1};
+    std::atomic<double> device_latency_ {0.0};
+
+    // Output latency measurement, callback only: once the device runs steadily, what it
+    // has been handed minus the wall time since it started is what it still buffers.
+    std::atomic<bool> latency_restart_ {false};
+    std::atomic<bool> latency_measured_ {false};
+    double latency_origin_ {0.0};
+    std::size_t latency_delivered_ {0};
+    double latency_sum_ {0.0};
+    int latency_samples_ {0};
+
+    // Audio clock. The refill thread anchors a ring position to a media time whenever the
+    // speed changes or the stream jumps; the callback turns its read position into the
+    // time of the last sample it handed over. The callback plays up to a buffer behind the
+    // refill thread, so recent anchors are kept and it uses the one covering its position.
+    // Each slot is published under its own sequence counter so the callback never sees
+    // half of one.
+    static constexpr std::size_t anchor_history = 32;
+    struct AnchorSlot {
+        std::atomic<uint32_t> sequence {0};
+        std::atomic<uint64_t> index {0}; // which anchor since the last clear it holds
+        std::atomic<std::size_t> frame {0};
+        std::atomic<double> pts {0.0};
+        std::atomic<double> speed {1.0};
+        std::atomic<double> previous_speed {1.0};
+    };
+    ClockAnchor anchor_; // the newest, refill thread only
+    bool has_anchor_ {false};
+    std::array<AnchorSlot, anchor_history> anchor_slots_ {};
+    std::atomic<uint64_t> anchor_count_ {0}; // anchors published since the last clear
+    std::atomic<double> callback_pts_ {0.0};
+    std::atomic<double> callback_speed_ {1.0};
+    std::atomic<double> callback_time_ {0.0};
+    std::atomic<bool> has_clock_ {false};
+
+    TimeStretcher stretcher_;
+    std::vector<float> stretched_;
+    std::atomic<double> speed_ {1.0};
+    std::atomic<StretchAlgorithm> stretch_algorithm_ {StretchAlgorithm::Bypass};
+    std::atomic<double> stretch_load_ {0.0};
+
+    // Sync corrections, requested by the player and applied on the refill thread.
+    std::atomic<double> resample_rate_ {1.0};
+    std::atomic<double> pending_shift_ {0.0};
+    double compensation_residual_ {0.0};
+    bool compensating_ {false};
+    std::size_t skip_frames_ {0};
+
+    std::thread refill_thread_;
+    std::mutex refill_mutex_;
+    std::condition_variable refill_cv_;
+    bool refill_stop_ {false};
+
+    // Set once data follows a clear, so an empty buffer before the first frame is no underrun.
+    std::atomic<bool> primed_ {false};
+    std::atomic<uint64_t> underruns_ {0};
+    std::atomic<uint64_t> overruns_ {0};
     std::atomic<float> volume_ {1.0F};
     std::atomic<bool> muted_ {false};
+    std::atomic<float> balance_ {0.0F};
+    std::atomic<bool> silenced_ {false};
+    MixFunction mix_ {nullptr};
+    ChannelGains applied_gains_ {}; // callback only: where the last gain ramp ended
 };
 
 } // namespace raha::core
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace raha::core {
+
+// Fixed-capacity sample FIFO for exactly one producer thread and one consumer thread.
+// Neither side locks or allocates; each only publishes its own index. Capacity is
+// rounded up to a power of two.
+class AudioRingBuffer {
+public:
+    AudioRingBuffer() = default;
+    explicit AudioRingBuffer(std::size_t capacity);
+
+    AudioRingBuffer(const AudioRingBuffer&) = delete;
+    AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+    // Not thread-safe: neither side may be running.
+    void reset(std::size_t capacity);
+    void clear();
+
+    // Producer side. Returns the number of samples written, less than `count` when full.
+    std::size_t write(const float* samples, std::size_t count);
+    // Consumer side. Returns the number of samples read, less than `count` when empty.
+    std::size_t read(float* samples, std::size_t count);
+
+    [[nodiscard]] std::size_t size() const;
+    // Samples written and read since the last clear.
+    [[nodiscard]] std::size_t produced() const { return write_index_.load(std::memory_order_acquire); }
+    [[nodiscard]] std::size_t consumed() const { return read_index_.load(std::memory_order_acquire); }
+    [[nodiscard]] std::size_t capacity() const { return capacity_; }
+
+private:
+    std::unique_ptr<float[]> data_;
+    std::size_t capacity_ {0};
+    std::size_t mask_ {0};
+    // Free-running counters; their difference is the fill level.
+    std::atomic<std::size_t> write_index_ {0};
+    std::atomic<std::size_t> read_index_ {0};
+};
+
+} // namespace raha::core
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "raha/core/ApplicationConfig.hpp"
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace raha::core {
+
+enum class ColorKernel {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Per-pixel tables in Q6 fixed point. Range expansion, brightness, contrast and gamma are
+// folded into the luma table; the colour matrix, chroma range and saturation into four
+// Q12 coefficients applied to (sample - 128). A channel is luma + chroma term, >> 6,
+// saturated to 8 bits. Gamma acts on luma only.
+struct ColorLuts {
+    // int32 so the AVX2 kernel can gather straight from it; every entry fits in int16.
+    std::array<int32_t, 256> y {};
+    int16_t rv {0};
+    int16_t gu {0};
+    int16_t gv {0};
+    int16_t bu {0};
+};
+
+// Adjustments are offsets around 0: brightness is added to normalised luma, contrast and
+// saturation scale by (1 + value), and gamma raises luma to 2^-gamma.
+[[nodiscard]] bool adjustments_active(const VideoAdjustments& adjustments);
+[[nodiscard]] ColorLuts build_color_luts(const VideoAdjustments& adjustments, AVColorSpace colorspace, AVColorRange range);
+// The matrix a frame is tagged with, when it names a YUV one. Untagged video falls back to
+// BT.709 from 720 lines of source height up and BT.601 below.
+[[nodiscard]] AVColorSpace resolve_colorspace(AVColorSpace tagged, int source_height);
+// Full range when tagged so or for the deprecated yuvj formats, which carry no tag.
+[[nodiscard]] bool full_range(const AVFrame* frame);
+
+// Writes `width` BGRA pixels from 8-bit luma and one u and v sample per two pixels. The
+// vector kernels do the luma lookup and the chroma matrix in registers; every kernel
+// produces identical output.
+using ColorRowFunction = void (*)(const ColorLuts& luts, const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width);
+
+[[nodiscard]] ColorKernel detect_color_kernel();
+// Null when the kernel was not built for this target or the CPU lacks it.
+[[nodiscard]] ColorRowFunction color_row_function(ColorKernel kernel);
+[[nodiscard]] const char* to_string(ColorKernel kernel);
+
+// YUV -> BGRA with VideoAdjustments applied in the same pass, for 8-bit 4:2:0 sources
+// (planar, NV12 or NV21).
+class ColorConverter {
+public:
+    ColorConverter();
+
+    bool set_kernel(ColorKernel kernel);
+    [[nodiscard]] ColorKernel kernel() const { return kernel_; }
+
+    // Rebuilds the tables only when something changed.
+    void configure(const VideoAdjustments& adjustments, AVColorSpace colorspace, AVColorRange range);
+
+    [[nodiscard]] static bool supports(AVPixelFormat format);
+    bool convert(const AVFrame* src, uint8_t* dst, int dst_pitch);
+
+private:
+    ColorKernel kernel_ {ColorKernel::Scalar};
+    ColorRowFunction row_ {nullptr};
+    ColorLuts luts_;
+    bool configured_ {false};
+    VideoAdjustments adjustments_;
+    AVColorSpace colorspace_ {AVCOL_SPC_UNSPECIFIED};
+    AVColorRange range_ {AVCOL_RANGE_UNSPECIFIED};
+    // NV12/NV21 chroma, split into planar rows once per chroma row.
+    std::vector<uint8_t> u_row_;
+    std::vector<uint8_t> v_row_;
+};
+
+} // namespace raha::core
@@ -0,0 +1,71 @@
+#pragma once
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <optional>
+
+namespace raha::core {
+
+// Ordered from best to cheapest; each level includes the savings of the ones before it.
+enum class DecodeQuality {
+    Full,
+    SkipLoopFilter,
+    SkipNonRef,
+    LowRes,
+    KeyframeOnly
+};
+
+struct DecodeQualityTuning {
+    double average_weight {0.1};
+    double degrade_ratio {1.0}; // average decode time / frame interval that counts as falling behind
+    double recover_ratio {0.6}; // ... and that counts as headroom
+    int degrade_samples {24};
+    int recover_samples {240};
+    int settle_samples {30}; // ignored after every change while the average adapts
+};
+
+struct DecodeDiscardSettings {
+    AVDiscard skip_frame {AVDISCARD_DEFAULT};
+    AVDiscard skip_idct {AVDISCARD_DEFAULT};
+    AVDiscard skip_loop_filter {AVDISCARD_DEFAULT};
+    bool lowres {false};
+};
+
+[[nodiscard]] const char* to_string(DecodeQuality quality);
+[[nodiscard]] DecodeDiscardSettings discard_settings(DecodeQuality quality);
+
+// Steps video decoding down one level at a time while the moving average of the time
+// spent per packet stays above the frame interval, and back up once it has stayed well
+// below it for much longer. The asymmetric thresholds keep it from oscillating.
+class DecodeQualityController {
+public:
+    explicit DecodeQualityController(DecodeQualityTuning tuning = {});
+
+    void reset(double frame_interval, bool lowres_supported);
+    void set_frame_interval(double seconds) { frame_interval_ = seconds; }
+
+    // Feeds the decode time of one packet; returns the new level when it changes.
+    std::optional<DecodeQuality> record(double decode_seconds);
+
+    [[nodiscard]] DecodeQuality level() const { return level_; }
+    [[nodiscard]] double average() const { return average_; }
+    [[nodiscard]] double frame_interval() const { return frame_interval_; }
+
+private:
+    [[nodiscard]] DecodeQuality step(int direction) const;
+    void change(DecodeQuality level);
+
+    DecodeQualityTuning tuning_;
+    DecodeQuality level_ {DecodeQuality::Full};
+    double frame_interval_ {0.0};
+    double average_ {0.0};
+    bool has_average_ {false};
+    bool lowres_supported_ {false};
+    int since_change_ {0};
+    int over_ {0};
+    int under_ {0};
+};
+
+} // namespace raha::core
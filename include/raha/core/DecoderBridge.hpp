@@ -1,15 +1,25 @@
 #pragma once
 
+#include "raha/core/ApplicationConfig.hpp"
+#include "raha/core/DecodeQualityController.hpp"
+#include "raha/core/FramePool.hpp"
 #include "raha/core/FrameQueue.hpp"
 #include "raha/core/MediaSource.hpp"
+#include "raha/core/PacketQueue.hpp"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
-#include <queue>
+#include <string>
+#include <thread>
 
 namespace raha::core {
 
@@ -19,14 +29,22 @@ struct CodecContextDeleter {
     }
 };
 
-struct PacketDeleter {
-    void operator()(AVPacket* pkt) const {
-        av_packet_free(&pkt);
+using CodecContextPtr = std::unique_ptr<AVCodecContext, CodecContextDeleter>;
+
+struct CodecParametersDeleter {
+    void operator()(AVCodecParameters* params) const {
+        avcodec_parameters_free(&params);
     }
 };
 
-using CodecContextPtr = std::unique_ptr<AVCodecContext, CodecContextDeleter>;
-using PacketPtr = std::unique_ptr<AVPacket, PacketDeleter>;
+using CodecParametersPtr = std::unique_ptr<AVCodecParameters, CodecParametersDeleter>;
+
+struct DecoderThreadingInfo {
+    std::string codec_name;
+    int thread_count {1};
+    bool frame_threading {false};
+    bool slice_threading {false};
+};
 
 class DecoderBridge {
 public:
@@ -36,29 +54,100 @@ public:
     DecoderBridge(const DecoderBridge&) = delete;
     DecoderBridge& operator=(const DecoderBridge&) = delete;
 
-    bool prepare(MediaSource& source);
+    bool prepare(MediaSource& source, const DecoderSettings& settings);
     void shutdown();
 
     std::optional<FramePtr> next_video_frame();
     std::optional<FramePtr> next_audio_frame();
 
-    bool seek(double seconds);
-
-    [[nodiscard]] AVCodecContext* video_context() const { return video_ctx_.get(); }
-    [[nodiscard]] AVCodecContext* audio_context() const { return audio_ctx_.get(); }
+    // With a byte position the demuxer is repositioned directly (AVSEEK_FLAG_BYTE) instead
+    // of searching the container's own index for `seconds`. An exact seek decodes forward
+    // from the keyframe, skipping non-reference frames, and only queues frames from
+    // `seconds` onwards.
+    bool seek(double seconds, std::optional<int64_t> byte_position = std::nullopt, bool exact = false);
+
+    // The video context is replaced when the decoder is reopened for lowres; a context
+    // handed out here stays valid but may no longer be the one decoding.
+    [[nodiscard]] std::shared_ptr<AVCodecContext> video_context() const { return video_.context(); }
+    [[nodiscard]] std::shared_ptr<AVCodecContext> audio_context() const { return audio_.context(); }
+    [[nodiscard]] const DecoderThreadingInfo& video_threading() const { return video_.threading; }
+    [[nodiscard]] const DecoderThreadingInfo& audio_threading() const { return audio_.threading; }
+    [[nodiscard]] FramePoolStats pool_stats() const { return frame_pool_.stats(); }
+    [[nodiscard]] DecodeQuality video_quality() const { return video_quality_level_; }
+
+    // Invoked on the video decode thread after every queued video frame; set before prepare().
+    void set_frame_callback(std::function<void()> callback) { frame_callback_ = std::move(callback); }
+
+    // Scales the frame interval the adaptive quality controller measures against.
+    void set_playback_speed(double speed) { playback_speed_ = speed; }
+    // Minimum video lowres level, applied from the next keyframe; capped by the codec.
+    void set_lowres_hint(int lowres) { lowres_hint_ = lowres; }
+    // Trick play: video packets other than keyframes are dropped before decoding. Full
+    // decoding resumes at the next keyframe.
+    void set_keyframes_only(bool enabled) { keyframes_only_ = enabled; }
 
 private:
-    CodecContextPtr create_context(MediaSource& source, AVMediaType type, std::optional<int> index);
+    struct StreamDecoder {
+        StreamDecoder(PacketQueueLimits limits, std::size_t frame_capacity) : packets(limits), frames(frame_capacity) {}
+
+        [[nodiscard]] std::shared_ptr<AVCodecContext> context() const {
+            std::scoped_lock lock(ctx_mutex);
+            return ctx;
+        }
+        void set_context(std::shared_ptr<AVCodecContext> next) {
+            std::scoped_lock lock(ctx_mutex);
+            ctx = std::move(next);
+        }
+
+        // Written by prepare() and by the worker when it reopens; read under ctx_mutex
+        // from other threads.
+        std::shared_ptr<AVCodecContext> ctx;
+        mutable std::mutex ctx_mutex;
+        // Copied in prepare(), so a reopen never touches the demuxer's streams while
+        // av_read_frame runs on the demux thread.
+        CodecParametersPtr params;
+        bool active {false}; // the stream has a decoder; only changes while no thread runs
+        PacketQueue packets;
+        FrameQueue frames;
+        std::thread worker;
+        DecoderThreadingInfo threading;
+        int stream_index {-1};
+        AVRational time_base {1, AV_TIME_BASE};
+        int64_t frame_duration {0};
+        // Exact-seek target in time_base units, published before the flush that starts
+        // the serial it applies to.
+        std::atomic<int64_t> catch_up_pts {AV_NOPTS_VALUE};
+    };
+
+    CodecContextPtr create_context(const AVCodecParameters* params, AVRational time_base, const DecoderSettings& settings, int lowres = 0);
+
+    void start_decoders();
+    void stop_decoders();
+    void decode_loop(StreamDecoder& stream);
+
+    void start_demuxer();
+    void stop_demuxer();
+    void demux_loop();
+    bool demux_queues_full() const;
 
     MediaSource* source_ {nullptr};
-    CodecContextPtr video_ctx_;
-    CodecContextPtr audio_ctx_;
-    PacketPtr packet_;
-    std::queue<FramePtr> video_frames_;
-    std::queue<FramePtr> audio_frames_;
-    int video_stream_index_ {-1};
-    int audio_stream_index_ {-1};
-    bool eof_ {false};
+    FramePool frame_pool_;
+    StreamDecoder video_;
+    StreamDecoder audio_;
+
+    std::thread demux_thread_;
+    std::mutex demux_mutex_;
+    std::condition_variable demux_cv_;
+    std::atomic<bool> demux_stop_ {false};
+    std::atomic<bool> decode_stop_ {false};
+    DecoderSettings settings_;
+    // Owned by the video decode worker; the level is mirrored for other threads.
+    DecodeQualityController video_quality_;
+    std::atomic<DecodeQuality> video_quality_level_ {DecodeQuality::Full};
+    std::atomic<double> playback_speed_ {1.0};
+    std::atomic<int> lowres_hint_ {0};
+    std::atomic<bool> keyframes_only_ {false};
+    std::function<void()> frame_callback_;
 };
 
 } // namespace raha::core
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace raha::core {
+
+struct PacingStats {
+    double refresh_interval {0.0}; // estimated vsync period
+    double mean_display {0.0};     // average time a frame stayed on screen
+    double jitter {0.0};           // standard deviation of those display durations
+    uint64_t frames {0};
+};
+
+// Tracks the display's vsync from the times vsync-blocked presents return and maps video
+// frames onto it. All times are steady-clock seconds except media time, which is in the
+// playback clock's seconds.
+class FramePacer {
+public:
+    void reset(double nominal_interval);
+
+    // Called right after a present that waits for vsync has returned.
+    void record_present(double time);
+    // The last recorded present put a new video frame on screen.
+    void record_frame_shown();
+
+    [[nodiscard]] double next_vsync(double now) const;
+    // Media time frames are selected for at the next vsync. Each frame is assigned to the
+    // vsync nearest its pts, which turns 24p on 60 Hz into a steady 3:2 cadence.
+    [[nodiscard]] double display_time(double now, double clock_time, double speed) const;
+    // Clock speed factor that makes frames of `frame_duration` last a whole number of
+    // vsyncs, or 1.0 when that needs a larger correction than `max_correction`.
+    [[nodiscard]] double clock_correction(double frame_duration, double max_correction) const;
+
+    [[nodiscard]] double refresh_interval() const { return period_; }
+    [[nodiscard]] PacingStats stats() const;
+
+private:
+    double nominal_ {1.0 / 60.0};
+    double period_ {1.0 / 60.0};
+    double last_vsync_ {0.0};
+    bool has_vsync_ {false};
+    double last_frame_shown_ {0.0};
+    bool has_frame_shown_ {false};
+    uint64_t frames_ {0};
+    std::deque<double> durations_;
+};
+
+} // namespace raha::core
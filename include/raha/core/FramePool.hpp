@@ -0,0 +1,78 @@
+#pragma once
+
+#include "raha/core/FrameQueue.hpp"
+#include "raha/core/PacketQueue.hpp"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+}
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace raha::core {
+
+struct FramePoolStats {
+    uint64_t frame_hits {0};
+    uint64_t frame_misses {0};
+    uint64_t packet_hits {0};
+    uint64_t packet_misses {0};
+    uint64_t buffer_hits {0};
+    uint64_t buffer_misses {0};
+};
+
+// Recycles AVFrame/AVPacket shells and serves decoder picture/sample buffers from
+// size-bucketed AVBufferPools of 64-byte aligned memory. Frames and packets handed out
+// by the pool return to it when their smart pointer is destroyed, so the pool must
+// outlive every frame and packet it created.
+class FramePool {
+public:
+    static constexpr std::size_t buffer_alignment = 64;
+
+    explicit FramePool(std::size_t max_shells = 64);
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    void set_huge_pages(bool enabled) { huge_pages_ = enabled; }
+    void attach(AVCodecContext* ctx);
+
+    FramePtr acquire_frame();
+    PacketPtr acquire_packet();
+    void recycle(AVFrame* frame);
+    void recycle(AVPacket* packet);
+
+    [[nodiscard]] FramePoolStats stats() const;
+
+private:
+    static int get_buffer(AVCodecContext* ctx, AVFrame* frame, int flags);
+    static AVBufferRef* allocate_buffer(void* opaque, std::size_t size);
+
+    int get_video_buffer(AVCodecContext* ctx, AVFrame* frame);
+    int get_audio_buffer(AVFrame* frame);
+    AVBufferRef* buffer_for(std::size_t size);
+
+    std::size_t max_shells_;
+    std::vector<AVFrame*> frame_shells_;
+    std::vector<AVPacket*> packet_shells_;
+    std::mutex shell_mutex_;
+
+    std::map<std::size_t, AVBufferPool*> buckets_;
+    std::mutex bucket_mutex_;
+    std::atomic<bool> huge_pages_ {false};
+
+    std::atomic<uint64_t> frame_hits_ {0};
+    std::atomic<uint64_t> frame_misses_ {0};
+    std::atomic<uint64_t> packet_hits_ {0};
+    std::atomic<uint64_t> packet_misses_ {0};
+    std::atomic<uint64_t> buffer_requests_ {0};
+    std::atomic<uint64_t> buffer_misses_ {0};
+};
+
+} // namespace raha::core
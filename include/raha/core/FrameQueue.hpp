@@ -12,28 +12,38 @@ extern "C" {
 
 namespace raha::core {
 
+class FramePool;
+
+// Frames acquired from a FramePool go back to it; everything else is freed.
 struct FrameDeleter {
-    void operator()(AVFrame* frame) const {
-        av_frame_free(&frame);
-    }
+    FramePool* pool {nullptr};
+    void operator()(AVFrame* frame) const;
 };
 
 using FramePtr = std::unique_ptr<AVFrame, FrameDeleter>;
 
+// Bounded frame FIFO between a decode worker and the render loop. push() blocks while the
+// queue is full; frames tagged with a serial older than the last flush() are discarded.
 class FrameQueue {
 public:
     explicit FrameQueue(std::size_t capacity = 10);
 
-    void push(FramePtr frame);
+    void push(FramePtr frame, int serial);
     FramePtr pop();
+    FramePtr try_pop();
     void clear();
+    void flush(int serial);
     void stop();
+    void start();
+
+    [[nodiscard]] std::size_t size() const;
 
 private:
     std::size_t capacity_;
     std::queue<FramePtr> queue_;
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
     std::condition_variable cv_;
+    int serial_ {0};
     bool stop_ {false};
 };
 
@@ -0,0 +1,52 @@
+#pragma once
+
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace raha::core {
+
+struct KeyframeEntry {
+    int64_t pts {0};
+    int64_t pos {0};
+};
+
+// Sorted keyframe timestamps (in the stream's time base) and the byte offsets of the
+// packets carrying them. The serialized form stores both columns as zigzag varint deltas,
+// which keeps an index for a two-hour file in the tens of kilobytes.
+class KeyframeIndex {
+public:
+    KeyframeIndex() = default;
+    KeyframeIndex(int stream_index, AVRational time_base);
+
+    // Reads every packet of `stream_index` through a private demuxer instance. Returns
+    // std::nullopt when the file cannot be read or `cancel` is raised midway.
+    static std::optional<KeyframeIndex> build(const std::string& path, int stream_index, const std::atomic<bool>& cancel);
+    static std::optional<KeyframeIndex> decode(const std::vector<uint8_t>& data, int stream_index, AVRational time_base);
+
+    void add(int64_t pts, int64_t pos);
+    void finish();
+
+    // Last keyframe at or before `pts`, or the first keyframe when `pts` precedes it.
+    [[nodiscard]] std::optional<KeyframeEntry> find(int64_t pts) const;
+    [[nodiscard]] std::vector<uint8_t> encode() const;
+
+    [[nodiscard]] int stream_index() const { return stream_index_; }
+    [[nodiscard]] AVRational time_base() const { return time_base_; }
+    [[nodiscard]] const std::vector<KeyframeEntry>& entries() const { return entries_; }
+    [[nodiscard]] std::size_t size() const { return entries_.size(); }
+    [[nodiscard]] bool empty() const { return entries_.empty(); }
+
+private:
+    int stream_index_ {-1};
+    AVRational time_base_ {1, 1};
+    std::vector<KeyframeEntry> entries_;
+};
+
+} // namespace raha::core
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -18,6 +20,31 @@ struct MediaEntry {
     std::string resolution;
 };
 
+// Size and modification time of a local file; cached entries are only valid while
+// both still match.
+struct FileStamp {
+    uint64_t size {0};
+    int64_t modified_time {0};
+};
+
+[[nodiscard]] std::optional<FileStamp> file_stamp(const std::filesystem::path& path);
+
+// Result of a full avformat_find_stream_info pass, keyed by path + size + mtime.
+// `streams` is the JSON written by MediaSource; `extradata` holds every stream's
+// extradata back to back in stream order.
+struct ProbeCacheEntry {
+    uint64_t file_size {0};
+    int64_t modified_time {0};
+    std::string format_name;
+    std::string streams;
+    std::vector<uint8_t> extradata;
+};
+
+struct KeyframeIndexRecord {
+    int stream_index {-1};
+    std::vector<uint8_t> entries;
+};
+
 class LibraryDatabase {
 public:
     LibraryDatabase();
@@ -30,8 +57,16 @@ public:
     void upsert_entry(const MediaEntry& entry);
     [[nodiscard]] std::vector<MediaEntry> search(const std::string& query) const;
 
+    [[nodiscard]] std::optional<ProbeCacheEntry> find_probe(const std::filesystem::path& path, uint64_t file_size, int64_t modified_time) const;
+    void store_probe(const std::filesystem::path& path, const ProbeCacheEntry& entry);
+
+    [[nodiscard]] std::optional<KeyframeIndexRecord> find_keyframe_index(const std::filesystem::path& path, const FileStamp& stamp) const;
+    void store_keyframe_index(const std::filesystem::path& path, const FileStamp& stamp, const KeyframeIndexRecord& record);
+
 private:
     sqlite3* db_ {nullptr};
+    // Keyframe indexes are written from background workers.
+    mutable std::mutex mutex_;
 };
 
 } // namespace raha::core
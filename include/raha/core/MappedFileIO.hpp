@@ -0,0 +1,47 @@
+#pragma once
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace raha::core {
+
+enum class AccessPattern {
+    Sequential,
+    Random
+};
+
+// Serves an AVIOContext straight from a read-only mapping of a local file, avoiding a
+// read() syscall per buffer refill. open() returns false when the file cannot be mapped
+// (or on platforms without mmap) so callers can fall back to libavformat's own I/O.
+class MappedFileIO {
+public:
+    MappedFileIO();
+    ~MappedFileIO();
+
+    MappedFileIO(const MappedFileIO&) = delete;
+    MappedFileIO& operator=(const MappedFileIO&) = delete;
+
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    void advise(AccessPattern pattern);
+
+    [[nodiscard]] AVIOContext* context() const { return io_ctx_; }
+    [[nodiscard]] std::size_t size() const { return size_; }
+
+private:
+    static int read_packet(void* opaque, uint8_t* buffer, int buffer_size);
+    static int64_t seek(void* opaque, int64_t offset, int whence);
+
+    const uint8_t* data_ {nullptr};
+    std::size_t size_ {0};
+    std::size_t position_ {0};
+    AVIOContext* io_ctx_ {nullptr};
+};
+
+} // namespace raha::core
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "raha/core/ApplicationConfig.hpp"
+
+#include <cstdint>
+#include <optional>
+
+namespace raha::core {
+
+struct SyncTuning {
+    double average_weight {0.1};      // weight of each new measurement in the drift average
+    double convergence_seconds {2.0}; // a measured drift is worked off over about this long
+    double max_correction {0.005};    // largest relative rate change used to slew the follower
+    double resync_threshold {0.1};    // drifts beyond this are fixed with a jump instead
+    int warmup_samples {10};          // measurements averaged before the first correction
+};
+
+struct SyncCorrection {
+    double rate {1.0};          // factor for the follower's speed
+    std::optional<double> jump; // seconds the follower has to move forward (negative: back)
+};
+
+struct SyncStats {
+    SyncMode mode {SyncMode::Audio};
+    double drift {0.0}; // averaged master minus follower time
+    double rate {1.0};
+    uint64_t resyncs {0};
+};
+
+// Decides which clock playback follows and steers the follower toward it. Small drift is
+// slewed away by running the follower up to max_correction faster or slower, so long
+// sessions stay in sync without audible or visible jumps; only a drift that slewing
+// cannot absorb (a stall, a changed audio delay) is fixed with a jump.
+class MasterClock {
+public:
+    explicit MasterClock(SyncTuning tuning = {});
+
+    void set_mode(SyncMode mode) { mode_ = mode; }
+    [[nodiscard]] SyncMode mode() const { return mode_; }
+    // The mode in effect: Audio needs a measurable audio clock and falls back to Video.
+    [[nodiscard]] SyncMode effective_mode(bool audio_available) const;
+
+    // Forgets the drift history, e.g. after a seek.
+    void reset();
+    // Feeds one simultaneous reading of both clocks.
+    SyncCorrection update(double master_time, double follower_time);
+
+    [[nodiscard]] double drift() const { return average_; }
+    [[nodiscard]] SyncStats stats(bool audio_available) const;
+
+private:
+    SyncTuning tuning_;
+    SyncMode mode_ {SyncMode::Audio};
+    double average_ {0.0};
+    double rate_ {1.0};
+    int samples_ {0};
+    uint64_t resyncs_ {0};
+};
+
+} // namespace raha::core
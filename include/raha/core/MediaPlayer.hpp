@@ -4,15 +4,24 @@
 #include "raha/core/AudioRenderer.hpp"
 #include "raha/core/Clock.hpp"
 #include "raha/core/DecoderBridge.hpp"
+#include "raha/core/FramePacer.hpp"
 #include "raha/core/FrameQueue.hpp"
+#include "raha/core/KeyframeIndex.hpp"
+#include "raha/core/LibraryDatabase.hpp"
+#include "raha/core/MasterClock.hpp"
 #include "raha/core/MediaSource.hpp"
+#include "raha/core/ReverseDecoder.hpp"
 #include "raha/core/SubtitleManager.hpp"
+#include "raha/core/TrickPlay.hpp"
 #include "raha/core/VideoRenderer.hpp"
 #include "raha/utils/ThreadPool.hpp"
 
 #include <SDL.h>
 #include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <future>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
@@ -28,6 +37,12 @@ enum class PlayerState {
     Error
 };
 
+struct PlaybackStats {
+    uint64_t rendered {0};
+    uint64_t dropped {0}; // superseded or late, before conversion
+    uint64_t late {0};    // of those dropped, the ones over the late threshold
+};
+
 class MediaPlayer {
 public:
     MediaPlayer();
@@ -43,28 +58,71 @@ public:
     void pause();
     void stop();
 
-    bool seek(double seconds);
+    bool seek(double seconds, std::optional<int64_t> byte_position = std::nullopt, bool exact = false);
     void set_playback_speed(double speed);
+    // Plays backwards from the current position at the playback speed, with audio paused.
+    // False when there is no video or the file cannot be opened a second time.
+    bool set_reverse(bool reverse);
+    [[nodiscard]] bool reversing() const { return reverse_; }
+    // Pauses and shows the frame before the one on screen, however far back its keyframe
+    // is. Playing again continues forward from there.
+    bool step_back();
 
     void update();
     void present();
+    // Called once the renderer's present has returned; feeds the vsync estimate.
+    void frame_presented();
+    // Seconds until update() has work that no event will announce: uploading or showing a
+    // frame. Nullopt when only an event can create work. While it
+    // waits on the decoder, the player posts wake_event() once a frame arrives.
+    [[nodiscard]] std::optional<double> next_wakeup() const;
+    [[nodiscard]] Uint32 wake_event() const { return wake_event_; }
+    // Output size in pixels, e.g. from SDL_GetRendererOutputSize.
+    void resize(int width, int height);
 
     [[nodiscard]] PlayerState state() const { return state_; }
     [[nodiscard]] const MediaSource& source() const { return source_; }
     [[nodiscard]] double current_time() const;
     [[nodiscard]] double duration() const { return source_.duration_seconds(); }
+    [[nodiscard]] const PlaybackStats& playback_stats() const { return stats_; }
+    [[nodiscard]] const ConversionStats& conversion_stats() const { return video_renderer_.conversion_stats(); }
+    [[nodiscard]] PacingStats pacing_stats() const { return pacer_.stats(); }
+    [[nodiscard]] AudioBufferStats audio_stats() const { return audio_renderer_.stats(); }
+    [[nodiscard]] SyncStats sync_stats() const { return master_clock_.stats(audio_can_lead()); }
+    [[nodiscard]] TrickPlayStats trick_play_stats() const { return trick_play_.stats(); }
+    [[nodiscard]] ReverseStats reverse_stats() const { return reverse_decoder_.stats(); }
 
     void set_config(ApplicationConfig config) { config_ = std::move(config); }
     [[nodiscard]] const ApplicationConfig& config() const { return config_; }
 
+    void set_library(LibraryDatabase* library) { library_ = library; }
+    // Null until the background indexer has finished (or loaded the index from the library).
+    [[nodiscard]] std::shared_ptr<const KeyframeIndex> keyframe_index() const;
+
     void toggle_mute();
     void set_volume(float volume);
+    void set_balance(float balance);
     void set_video_adjustments(const VideoAdjustments& adjustments);
 
     void request_screenshot(const std::filesystem::path& path);
 
 private:
+    void start_keyframe_index(const std::string& uri);
+    void cancel_keyframe_index();
+    // Measures the audio clock against the playback clock and steers whichever follows.
+    void synchronize();
+    [[nodiscard]] bool audio_can_lead() const;
+    // Switches keyframe-only decoding on or off to match the playback speed.
+    void update_trick_play();
+    // Moves the demuxer to the first keyframe at or after `seconds` without touching the clock.
+    void trick_play_skip(double seconds);
+    bool start_reverse(double from);
+    void end_reverse();
+    void update_reverse();
+    [[nodiscard]] double reverse_time() const;
+
     ApplicationConfig config_;
+    LibraryDatabase* library_ {nullptr};
     MediaSource source_;
     DecoderBridge decoder_;
     SubtitleManager subtitle_manager_;
@@ -72,6 +130,11 @@ private:
     AudioRenderer audio_renderer_;
     utils::ThreadPool workers_;
 
+    std::shared_ptr<const KeyframeIndex> keyframe_index_;
+    mutable std::mutex index_mutex_;
+    std::shared_ptr<std::atomic<bool>> index_cancel_;
+    std::future<void> index_task_;
+
     std::atomic<PlayerState> state_ {PlayerState::Idle};
     std::atomic<bool> running_ {true};
     std::mutex playback_mutex_;
@@ -80,7 +143,32 @@ private:
     FramePtr pending_video_frame_;
     bool has_pending_video_ {false};
     double pending_video_pts_ {0.0};
+    // Set by a seek while not playing so the frame at the new position still gets shown.
+    bool show_seek_frame_ {false};
     const double video_sync_tolerance_ {0.02};
+    // However late frames run, one is still shown this often so the picture never freezes.
+    const double max_render_gap_ {0.25};
+    double last_render_time_ {0.0}; // steady seconds
+    // Frames due within this window are uploaded ahead into the texture ring.
+    const double prepare_ahead_ {0.1};
+    const double max_clock_correction_ {0.005};
+    FramePacer pacer_;
+    MasterClock master_clock_;
+    SyncMode sync_mode_ {SyncMode::Audio};
+    TrickPlay trick_play_;
+    bool trick_play_active_ {false};
+    // Reverse playback runs its own clock counting media seconds back from the origin.
+    ReverseDecoder reverse_decoder_;
+    Clock reverse_clock_;
+    bool reverse_ {false};
+    bool reverse_stepping_ {false}; // entered by step_back(); playing leaves it
+    double reverse_origin_ {0.0};
+    double reverse_frame_duration_ {1.0 / 30.0};
+    bool presented_new_frame_ {false};
+
+    Uint32 wake_event_ {0};
+    std::atomic<bool> wake_armed_ {false};
+    PlaybackStats stats_;
 };
 
 } // namespace raha::core
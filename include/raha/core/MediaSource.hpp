@@ -1,9 +1,14 @@
 #pragma once
 
+#include "raha/core/ApplicationConfig.hpp"
+#include "raha/core/LibraryDatabase.hpp"
+#include "raha/core/MappedFileIO.hpp"
+
 extern "C" {
 #include <libavformat/avformat.h>
 }
 
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -31,9 +36,13 @@ public:
     MediaSource(const MediaSource&) = delete;
     MediaSource& operator=(const MediaSource&) = delete;
 
-    bool open(const std::string& path);
+    // When a library is given, stream discovery for unchanged local files is served from
+    // its probe cache instead of running avformat_find_stream_info.
+    bool open(const std::string& path, const IoSettings& io = {}, LibraryDatabase* library = nullptr);
     void close();
 
+    void set_access_pattern(AccessPattern pattern);
+
     [[nodiscard]] bool is_open() const { return format_ctx_ != nullptr; }
     [[nodiscard]] const std::string& uri() const { return uri_; }
     [[nodiscard]] const std::vector<StreamInfo>& streams() const { return streams_; }
@@ -41,19 +50,26 @@ public:
     [[nodiscard]] std::optional<int> audio_stream_index() const { return audio_stream_index_; }
     [[nodiscard]] std::optional<int> subtitle_stream_index() const { return subtitle_stream_index_; }
     [[nodiscard]] double duration_seconds() const;
+    [[nodiscard]] bool memory_mapped() const { return mapped_io_ != nullptr; }
+    [[nodiscard]] bool probed_from_cache() const { return probed_from_cache_; }
 
     AVFormatContext* raw() { return format_ctx_; }
     const AVFormatContext* raw() const { return format_ctx_; }
 
 private:
     void discover_streams();
+    bool open_input(const std::string& path, const IoSettings& io, const ProbeCacheEntry* cached);
+    bool apply_probe_cache(const ProbeCacheEntry& cached);
+    [[nodiscard]] ProbeCacheEntry make_probe_cache_entry() const;
 
     AVFormatContext* format_ctx_ {nullptr};
+    std::unique_ptr<MappedFileIO> mapped_io_;
     std::string uri_;
     std::vector<StreamInfo> streams_;
     std::optional<int> video_stream_index_;
     std::optional<int> audio_stream_index_;
     std::optional<int> subtitle_stream_index_;
+    bool probed_from_cache_ {false};
 };
 
 } // namespace raha::core
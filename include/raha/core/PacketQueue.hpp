@@ -0,0 +1,71 @@
+#pragma once
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace raha::core {
+
+class FramePool;
+
+struct PacketDeleter {
+    FramePool* pool {nullptr};
+    void operator()(AVPacket* pkt) const;
+};
+
+using PacketPtr = std::unique_ptr<AVPacket, PacketDeleter>;
+
+struct PacketQueueLimits {
+    std::size_t max_bytes {16 * 1024 * 1024};
+    double max_duration_seconds {2.0};
+    std::size_t min_packets {25};
+};
+
+struct QueuedPacket {
+    PacketPtr packet;
+    int serial {0};
+};
+
+// Unbounded FIFO of demuxed packets for a single stream. The demuxer never blocks on push;
+// instead it polls has_enough() so that one full queue cannot starve the other stream.
+// A null PacketPtr is the end-of-stream marker. Every flush() starts a new serial so that
+// consumers can tell pre-seek packets from post-seek ones.
+class PacketQueue {
+public:
+    explicit PacketQueue(PacketQueueLimits limits = {});
+
+    void set_time_base(AVRational time_base);
+    void push(PacketPtr packet);
+    // Returns std::nullopt when nothing is queued (or the queue was aborted) and a null
+    // packet when the end-of-stream marker is reached.
+    std::optional<QueuedPacket> pop(bool block);
+    void flush();
+    void abort();
+    void start();
+
+    [[nodiscard]] bool has_enough() const;
+    [[nodiscard]] std::size_t bytes() const;
+    [[nodiscard]] double duration_seconds() const;
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] int serial() const;
+
+private:
+    PacketQueueLimits limits_;
+    AVRational time_base_ {1, AV_TIME_BASE};
+    std::deque<QueuedPacket> queue_;
+    std::size_t bytes_ {0};
+    int64_t duration_ {0};
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    int serial_ {0};
+    bool abort_ {false};
+};
+
+} // namespace raha::core
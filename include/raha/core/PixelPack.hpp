@@ -0,0 +1,35 @@
+#pragma once
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include <cstdint>
+#include <vector>
+
+namespace raha::core::pixel_pack {
+
+// Row kernels. SSE2 is part of the x86-64 baseline, so these are vectorised there without
+// runtime dispatch; other targets use the scalar loops, which produce identical output.
+
+// Narrows 16-bit samples to 8 bits by dropping `shift` low bits (8 for MSB-aligned P010,
+// depth - 8 for LSB-aligned formats such as yuv420p10le).
+void narrow_row(const uint16_t* src, uint8_t* dst, int count, int shift);
+// Rounded average of two rows: 4:2:2 chroma to 4:2:0.
+void average_rows(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, int count);
+// Rounded 2x2 box filter: 4:4:4 chroma to 4:2:0. `src_count` may be odd, the last
+// column is then repeated.
+void downsample_2x2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, int src_count);
+
+// Frame packers for formats SDL cannot upload directly. `dst` must already be allocated
+// with the matching format (AV_PIX_FMT_YUV420P / AV_PIX_FMT_NV12) and the source size.
+// Samples are copied at their range; the full-range yuvj formats are not packed.
+[[nodiscard]] bool can_pack_to_yuv420p(AVPixelFormat format);
+[[nodiscard]] bool can_pack_to_nv12(AVPixelFormat format);
+// `scratch` holds two narrowed chroma rows of high-depth sources. It is only grown, so a
+// caller that keeps it across frames allocates again only when the size increases.
+bool pack_to_yuv420p(const AVFrame* src, AVFrame* dst, std::vector<uint8_t>& scratch);
+bool pack_to_nv12(const AVFrame* src, AVFrame* dst);
+
+} // namespace raha::core::pixel_pack
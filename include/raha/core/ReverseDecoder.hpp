@@ -0,0 +1,119 @@
+#pragma once
+
+#include "raha/core/DecoderBridge.hpp"
+#include "raha/core/FrameQueue.hpp"
+#include "raha/core/KeyframeIndex.hpp"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace raha::core {
+
+struct ReverseTuning {
+    // Decoded frames held for the GOP being played and the one prefetched behind it.
+    std::size_t memory_limit {512U * 1024U * 1024U};
+    // Seeks that land on or after the end of the wanted GOP retry this many times, each
+    // time twice as far back.
+    int max_seek_attempts {6};
+};
+
+struct ReverseStats {
+    uint64_t gops {0};
+    uint64_t keyframe_only_gops {0}; // GOPs over budget, played back by their keyframe alone
+    std::size_t buffered_bytes {0};
+    double gop_decode_seconds {0.0}; // time the last GOP took to decode
+};
+
+// Bytes of picture data a decoded frame holds.
+[[nodiscard]] std::size_t frame_bytes(const AVFrame* frame);
+
+// One GOP's decoded frames, in presentation order once finish() has run.
+struct ReverseGop {
+    int64_t start {0}; // keyframe pts, in the stream's time base
+    std::vector<FramePtr> frames;
+    std::size_t bytes {0};
+    bool keyframe_only {false};
+
+    // Returns false once the GOP has outgrown `budget`; only its first frame, the
+    // keyframe, is kept then.
+    bool add(FramePtr frame, std::size_t budget);
+    void finish();
+};
+
+// Backward playback. Decoding only runs forward, so a worker decodes one GOP at a time
+// from its keyframe into memory and the player takes its frames last to first; while it
+// does, the worker already decodes the GOP before it. The worker has its own demuxer and
+// decoder, so forward playback state is left alone and can resume where reverse stops.
+class ReverseDecoder {
+public:
+    explicit ReverseDecoder(ReverseTuning tuning = {});
+    ~ReverseDecoder();
+
+    ReverseDecoder(const ReverseDecoder&) = delete;
+    ReverseDecoder& operator=(const ReverseDecoder&) = delete;
+
+    // Starts producing the frames before `seconds` of `stream_index`, newest first. The
+    // keyframe index, when there is one, saves a seek per GOP on containers whose own
+    // index is sparse.
+    bool start(const std::string& path, int stream_index, double seconds, std::shared_ptr<const KeyframeIndex> index);
+    void stop();
+    // Applies from the next GOP; safe while the worker runs.
+    void set_memory_limit(std::size_t bytes) { memory_limit_ = bytes; }
+    // Only keyframes are decoded, e.g. for fast reverse; applies from the next GOP.
+    void set_keyframes_only(bool enabled) { keyframes_only_ = enabled; }
+
+    // Nullopt while the worker has nothing ready.
+    std::optional<FramePtr> next_frame();
+    // The start of the stream has been reached and every frame handed out.
+    [[nodiscard]] bool finished() const;
+    [[nodiscard]] bool active() const { return worker_.joinable(); }
+    [[nodiscard]] AVRational time_base() const { return time_base_; }
+    [[nodiscard]] ReverseStats stats() const;
+
+private:
+    struct FormatContextDeleter {
+        void operator()(AVFormatContext* ctx) const {
+            avformat_close_input(&ctx);
+        }
+    };
+
+    bool open(const std::string& path, int stream_index);
+    void decode_loop(int64_t end);
+    // The GOP ending just before `end`; nullopt at the start of the stream or on error.
+    std::optional<ReverseGop> decode_gop(int64_t end);
+    // Decodes from the keyframe the demuxer was just moved to up to `end`.
+    std::optional<ReverseGop> decode_from_keyframe(int64_t end);
+
+    ReverseTuning tuning_;
+    std::unique_ptr<AVFormatContext, FormatContextDeleter> format_;
+    CodecContextPtr codec_;
+    std::string path_;
+    int stream_index_ {-1};
+    AVRational time_base_ {1, 1};
+    std::shared_ptr<const KeyframeIndex> index_;
+    std::atomic<std::size_t> memory_limit_;
+    std::atomic<bool> keyframes_only_ {false};
+
+    std::thread worker_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<ReverseGop> gops_; // newest first; the front one is being played
+    std::atomic<bool> stop_ {false};
+    bool finished_ {false};
+    ReverseStats stats_;
+};
+
+} // namespace raha::core
@@ -2,6 +2,9 @@
 
 #include "raha/core/MediaPlayer.hpp"
 
+#include <cstdint>
+#include <optional>
+
 namespace raha::core {
 
 class SeekController {
@@ -13,6 +16,9 @@ public:
     bool frame_step(int direction);
 
 private:
+    bool seek_to(double seconds, bool exact);
+    [[nodiscard]] std::optional<int64_t> indexed_position(double seconds) const;
+
     MediaPlayer& player_;
 };
 
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace raha::core {
+
+enum class StretchAlgorithm {
+    Bypass, // 1.0x: samples pass through untouched
+    Wsola,  // overlap-add with a waveform-similarity search; keeps pitch and timbre
+    Ola     // plain overlap-add; much cheaper, slightly rougher
+};
+
+struct TimeStretchTuning {
+    double hop_seconds {0.015};      // output hop; windows are twice as long
+    double search_seconds {0.008};   // WSOLA searches this far either side of the nominal position
+    double cheap_above_speed {2.0};  // faster speeds use Ola
+};
+
+struct TimeStretchStats {
+    StretchAlgorithm algorithm {StretchAlgorithm::Bypass};
+    double cpu_seconds {0.0};    // time spent stretching
+    double output_seconds {0.0}; // audio produced while stretching
+    // Fraction of one core needed to stretch in real time.
+    [[nodiscard]] double load() const { return output_seconds > 0.0 ? cpu_seconds / output_seconds : 0.0; }
+};
+
+[[nodiscard]] const char* to_string(StretchAlgorithm algorithm);
+
+// Changes the tempo of interleaved float audio without changing its pitch. Input is cut
+// into Hann windows spaced speed times the output hop apart and overlap-added at the
+// output hop. WSOLA shifts each window, within the search range, to where it best
+// continues the previous one, which avoids the phasing plain overlap-add produces.
+// Switching to and from 1.0x is seamless.
+class TimeStretcher {
+public:
+    explicit TimeStretcher(TimeStretchTuning tuning = {});
+
+    void configure(int sample_rate, int channels);
+    // Takes effect at the next window.
+    void set_speed(double speed);
+    // Drops buffered input, e.g. after a seek.
+    void reset();
+
+    // Appends `frames` frames of input and replaces `output` with the frames that are ready.
+    std::size_t process(const float* input, std::size_t frames, std::vector<float>& output);
+
+    // Input frames received but not yet played out, measured in input time. The next
+    // output frame corresponds to input received this many frames ago.
+    [[nodiscard]] double buffered_frames() const;
+    [[nodiscard]] double speed() const { return speed_; }
+    [[nodiscard]] StretchAlgorithm algorithm() const;
+    [[nodiscard]] TimeStretchStats stats() const;
+
+    [[nodiscard]] static StretchAlgorithm algorithm_for(double speed, double cheap_above_speed);
+
+private:
+    void start();
+    void finish(std::vector<float>& output);
+    bool step(std::vector<float>& output);
+    [[nodiscard]] int64_t best_offset(int64_t nominal);
+    [[nodiscard]] const float* frame_at(int64_t position) const;
+    void trim();
+
+    TimeStretchTuning tuning_;
+    int channels_ {2};
+    std::size_t hop_ {720};
+    int64_t search_ {384};
+    std::vector<float> window_; // rising half of the Hann window, hop_ entries
+
+    double speed_ {1.0};
+    bool active_ {false};
+    bool started_ {false};
+
+    std::vector<float> input_; // interleaved, starting at frame input_base_
+    int64_t input_base_ {0};
+    int64_t received_ {0};
+    double nominal_ {0.0};  // input position of the next window before the search
+    int64_t previous_ {0};  // input position of the last window used
+    std::vector<float> overlap_; // falling half of the last window, already weighted
+    std::vector<float> mono_;
+
+    double cpu_seconds_ {0.0};
+    double output_seconds_ {0.0};
+    int sample_rate_ {48000};
+};
+
+} // namespace raha::core
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace raha::core {
+
+struct TrickPlayTuning {
+    double max_decoded_speed {4.0}; // faster speeds use keyframes only whatever the setting
+    double lag_seconds {0.5};       // wall time the picture may trail the clock before skipping
+    double lead_seconds {0.25};     // a skip aims this much wall time ahead of the clock
+    double min_skip_interval {0.5}; // wall seconds between skips, so each can decode and show
+};
+
+struct TrickPlayStats {
+    bool active {false};
+    uint64_t skips {0};
+    double lag {0.0}; // media seconds between the clock and the newest picture shown
+};
+
+// Fast playback by keyframes. Above a configurable speed the decoder drops everything
+// but keyframes; when even those cannot keep up, because they are large or the GOPs
+// short, the player skips the demuxer ahead of the clock instead of reading and
+// decoding keyframes that would only be shown late.
+class TrickPlay {
+public:
+    explicit TrickPlay(TrickPlayTuning tuning = {});
+
+    // Speeds above this use keyframes only; capped at max_decoded_speed.
+    void set_threshold(double above_speed) { threshold_ = above_speed; }
+    [[nodiscard]] bool engaged(double speed) const;
+
+    // Starts over at `clock_time`, e.g. after a seek or when trick play starts.
+    void reset(double clock_time);
+    void set_active(bool active) { active_ = active; }
+    void frame_shown(double pts);
+    // Where to skip to when the picture trails the clock too far; at most one skip per
+    // min_skip_interval.
+    std::optional<double> skip_target(double clock_time, double speed, double now);
+
+    [[nodiscard]] TrickPlayStats stats() const;
+
+private:
+    TrickPlayTuning tuning_;
+    double threshold_ {2.0};
+    bool active_ {false};
+    double reference_ {0.0}; // newest picture shown, or where the last skip or reset went
+    double lag_ {0.0};
+    double last_skip_ {-std::numeric_limits<double>::infinity()};
+    uint64_t skips_ {0};
+};
+
+} // namespace raha::core
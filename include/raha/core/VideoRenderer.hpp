@@ -1,6 +1,8 @@
 #pragma once
 
 #include "raha/core/ApplicationConfig.hpp"
+#include "raha/core/ColorConvert.hpp"
+#include "raha/core/FrameQueue.hpp"
 
 extern "C" {
 #include <libavutil/frame.h>
@@ -9,12 +11,24 @@ extern "C" {
 struct SwsContext;
 
 #include <SDL.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
+#include <utility>
 #include <vector>
 
 namespace raha::core {
 
+struct ConversionStats {
+    double last_ms {0.0};
+    double average_ms {0.0};
+    uint64_t frames {0};
+    int threads {1};
+};
+
 class VideoRenderer {
 public:
     VideoRenderer();
@@ -25,27 +39,116 @@ public:
 
     bool initialize(SDL_Window* window, SDL_Renderer* renderer);
     void shutdown();
+    void configure(const RenderSettings& settings);
 
-    void render_frame(const AVFrame* frame, const VideoAdjustments& adjustments);
+    // Number of textures in the presentation ring: one on screen, the others filled ahead
+    // of their display time so a slow upload does not delay the next vsync.
+    static constexpr std::size_t texture_ring_size = 3;
+
+    // Converts and uploads into a spare texture, to be shown by present() once `pts` is
+    // due. Without a pts the frame is shown at the next present(); frames sharing a pts,
+    // pts-less ones included, are shown in the order they were rendered.
+    void render_frame(const AVFrame* frame, const VideoAdjustments& adjustments, std::optional<double> pts = std::nullopt);
+    // Output size in pixels. Larger videos are downscaled to it before upload.
     void resize(int width, int height);
+    // Decoder lowres level that still decodes at least the output size, 0 unless enabled
+    // in RenderSettings. Follows the output size only once a resize has settled.
+    [[nodiscard]] int lowres_for(int coded_width, int coded_height) const;
 
     void request_screenshot(const std::filesystem::path& path);
-    void present();
+    // Switches to the newest prepared frame due at `display_time` and draws the frame on
+    // screen. Returns true when that is a different frame than at the last present.
+    bool present(double display_time);
+    // True while a texture is free for a frame ahead of its display time.
+    [[nodiscard]] bool can_prepare() const;
+    // Earliest pts among prepared frames that are not on screen yet.
+    [[nodiscard]] std::optional<double> next_prepared_pts() const;
+    // Pts of the frame on screen; nullopt when there is none or it was rendered without one.
+    [[nodiscard]] std::optional<double> displayed_pts() const;
+    // Drops prepared frames that were not shown yet, e.g. after a seek.
+    void flush();
+
+    // Time spent converting or packing frames that cannot be uploaded as decoded.
+    [[nodiscard]] const ConversionStats& conversion_stats() const { return conversion_stats_; }
 
 private:
+    // How frames reach the texture: uploaded as decoded, packed to 8-bit 4:2:0 first, or
+    // converted to BGRA by swscale. Scale resizes to the output size with swscale, keeping
+    // the 4:2:0 layout for YUV sources. While video adjustments are active, every path
+    // produces 4:2:0 (swscale converting to it for Convert sources), which goes through
+    // ColorConverter into a BGRA texture instead.
+    enum class UploadPath {
+        Planar,
+        SemiPlanar,
+        PackPlanar,
+        PackSemiPlanar,
+        Scale,
+        Convert
+    };
+
+    [[nodiscard]] static UploadPath choose_upload_path(AVPixelFormat format);
+
     void apply_adjustments(const VideoAdjustments& adjustments);
-    void ensure_texture(int width, int height, AVPixelFormat format);
+    void ensure_texture(int width, int height, AVPixelFormat format, bool full_range_source);
+    void ensure_scaler(int width, int height, AVPixelFormat format);
+    // Points swscale at the frame's matrix and range, which it otherwise assumes to be
+    // BT.601, and tags converted_ with what the scaler writes into it.
+    void apply_scaler_colorspace(const AVFrame* frame);
+    [[nodiscard]] std::pair<int, int> target_size(int width, int height) const;
+    [[nodiscard]] int acquire_slot() const;
+    void release_textures();
+    [[nodiscard]] int conversion_threads(int height) const;
+    void allocate_converted(int width, int height, AVPixelFormat format);
+    void record_conversion(std::chrono::steady_clock::time_point start);
+    // Maps the streaming texture into texture_view_ as a frame of `format`, so packers,
+    // swscale and ColorConverter write into it without a staging copy.
+    bool lock_texture(AVPixelFormat format);
+    void unlock_texture();
+    bool upload_adjusted(const AVFrame* source);
 
     SDL_Window* window_ {nullptr};
     SDL_Renderer* renderer_ {nullptr};
+    struct TextureSlot {
+        SDL_Texture* texture {nullptr};
+        double pts {0.0};
+        uint64_t sequence {0}; // render order, breaking ties between equal pts
+        bool ready {false}; // holds a frame not yet replaced on screen
+    };
+    // Display order of two slots: by pts, then by render order.
+    [[nodiscard]] static bool shown_before(const TextureSlot& a, const TextureSlot& b) {
+        return a.pts < b.pts || (a.pts == b.pts && a.sequence < b.sequence);
+    }
+
+    std::array<TextureSlot, texture_ring_size> slots_ {};
+    int displayed_ {-1};
+    uint64_t next_sequence_ {0};
+    // The slot being written by render_frame.
     SDL_Texture* texture_ {nullptr};
+    Uint32 texture_format_ {SDL_PIXELFORMAT_IYUV};
     struct SwsContext* sws_ {nullptr};
     AVPixelFormat src_format_ {AV_PIX_FMT_NONE};
     int texture_width_ {0};
     int texture_height_ {0};
-    std::vector<uint8_t> pixel_buffer_;
-    bool has_frame_ {false};
-    bool use_yuv_texture_ {false};
+    int frame_width_ {0};
+    int frame_height_ {0};
+    int output_width_ {0};
+    int output_height_ {0};
+    int applied_output_width_ {0};
+    int applied_output_height_ {0};
+    std::chrono::steady_clock::time_point resized_at_ {};
+    AVPixelFormat scale_format_ {AV_PIX_FMT_BGRA};
+    int sws_threads_ {0};
+    AVColorSpace sws_colorspace_ {AVCOL_SPC_UNSPECIFIED}; // unspecified until first applied
+    bool sws_full_range_ {false};
+    FramePtr converted_;
+    FramePtr texture_view_;
+    std::vector<uint8_t> pack_scratch_; // narrowed chroma rows for pixel_pack, kept across frames
+    RenderSettings settings_;
+    ConversionStats conversion_stats_;
+    UploadPath upload_path_ {UploadPath::Convert};
+    ColorConverter color_converter_;
+    VideoAdjustments adjustments_;
+    bool adjusting_ {false};
     std::optional<std::filesystem::path> pending_screenshot_;
 };
 
@@ -31,6 +31,8 @@ public:
 
 private:
     void handle_event(const SDL_Event& event);
+    // -1 to wait for the next event indefinitely.
+    [[nodiscard]] int wait_timeout_ms() const;
     void render_ui();
     void persist_state();
 
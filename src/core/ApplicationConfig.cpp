@@ -1,19 +1,132 @@
 #include "raha/core/ApplicationConfig.hpp"
 
+#include "raha/utils/Logger.hpp"
+
 #include <nlohmann/json.hpp>
+#include <charconv>
 #include <fstream>
+#include <string>
 #include <stdexcept>
 
 namespace raha::core {
 namespace {
 using json = nlohmann::json;
 
+const char* to_string(DecoderThreadType type) {
+    switch (type) {
+    case DecoderThreadType::Frame:
+        return "frame";
+    case DecoderThreadType::Slice:
+        return "slice";
+    case DecoderThreadType::Auto:
+        break;
+    }
+    return "auto";
+}
+
+DecoderThreadType thread_type_from_string(const std::string& value) {
+    if (value == "frame") {
+        return DecoderThreadType::Frame;
+    }
+    if (value == "slice") {
+        return DecoderThreadType::Slice;
+    }
+    return DecoderThreadType::Auto;
+}
+
+const char* to_string(SyncMode mode) {
+    switch (mode) {
+    case SyncMode::Video:
+        return "video";
+    case SyncMode::External:
+        return "external";
+    case SyncMode::Audio:
+        break;
+    }
+    return "audio";
+}
+
+SyncMode sync_mode_from_string(const std::string& value) {
+    if (value == "video") {
+        return SyncMode::Video;
+    }
+    if (value == "external") {
+        return SyncMode::External;
+    }
+    return SyncMode::Audio;
+}
+
+const char* to_string(ResampleQuality quality) {
+    switch (quality) {
+    case ResampleQuality::Fast:
+        return "fast";
+    case ResampleQuality::High:
+        return "high";
+    case ResampleQuality::Balanced:
+        break;
+    }
+    return "balanced";
+}
+
+ResampleQuality resample_quality_from_string(const std::string& value) {
+    if (value == "fast") {
+        return ResampleQuality::Fast;
+    }
+    if (value == "high") {
+        return ResampleQuality::High;
+    }
+    return ResampleQuality::Balanced;
+}
+
+const char* to_string(DownmixMode mode) {
+    switch (mode) {
+    case DownmixMode::Itu:
+        return "itu";
+    case DownmixMode::Dialogue:
+        return "dialogue";
+    case DownmixMode::Normalized:
+        break;
+    }
+    return "normalized";
+}
+
+DownmixMode downmix_from_string(const std::string& value) {
+    if (value == "itu") {
+        return DownmixMode::Itu;
+    }
+    if (value == "dialogue") {
+        return DownmixMode::Dialogue;
+    }
+    return DownmixMode::Normalized;
+}
+
+json to_json(const DecoderThreadingPolicy& policy) {
+    return {
+        {"thread_type", to_string(policy.thread_type)},
+        {"thread_count", policy.thread_count}
+    };
+}
+
+DecoderThreadingPolicy threading_from_json(const json& j, DecoderThreadingPolicy policy) {
+    policy.thread_type = thread_type_from_string(j.value("thread_type", std::string(to_string(policy.thread_type))));
+    policy.thread_count = j.value("thread_count", policy.thread_count);
+    return policy;
+}
+
 json to_json(const ApplicationConfig& config) {
     json j;
     j["playback"] = {
         {"playback_speed", config.playback.playback_speed},
         {"loop_single", config.playback.loop_single},
-        {"shuffle", config.playback.shuffle}
+        {"shuffle", config.playback.shuffle},
+        {"exact_seek", config.playback.exact_seek},
+        {"drop_late_frames", config.playback.drop_late_frames},
+        {"late_frame_threshold", config.playback.late_frame_threshold},
+        {"display_sync", config.playback.display_sync},
+        {"sync_mode", to_string(config.playback.sync_mode)},
+        {"trick_play_above_speed", config.playback.trick_play_above_speed},
+        {"trick_play_audio", config.playback.trick_play_audio},
+        {"reverse_buffer_mb", config.playback.reverse_buffer_mb}
     };
     j["video_adjustments"] = {
         {"brightness", config.video_adjustments.brightness},
@@ -26,7 +139,12 @@ json to_json(const ApplicationConfig& config) {
         {"volume", config.audio.volume},
         {"muted", config.audio.muted},
         {"balance", config.audio.balance},
-        {"audio_delay", config.audio.audio_delay}
+        {"audio_delay", config.audio.audio_delay},
+        {"buffer_ms", config.audio.buffer_ms},
+        {"resample_quality", to_string(config.audio.resample_quality)},
+        {"downmix", to_string(config.audio.downmix)},
+        {"low_latency", config.audio.low_latency},
+        {"period_frames", config.audio.period_frames}
     };
     j["subtitles"] = {
         {"enabled", config.subtitles.enabled},
@@ -40,6 +158,24 @@ json to_json(const ApplicationConfig& config) {
         {"allow_streaming", config.network.allow_streaming},
         {"sandbox_streams", config.network.sandbox_streams}
     };
+    j["io"] = {
+        {"memory_map_local_files", config.io.memory_map_local_files}
+    };
+    j["render"]["conversion_threads"] = json::object();
+    for (const auto& [height, threads] : config.render.conversion_threads) {
+        j["render"]["conversion_threads"][std::to_string(height)] = threads;
+    }
+    j["render"]["downscale_to_output"] = config.render.downscale_to_output;
+    j["render"]["resize_cooldown_ms"] = config.render.resize_cooldown_ms;
+    j["render"]["decoder_lowres"] = config.render.decoder_lowres;
+    j["decoder"] = to_json(config.decoder.threading);
+    j["decoder"]["huge_page_buffers"] = config.decoder.huge_page_buffers;
+    j["decoder"]["seek_skip_loop_filter"] = config.decoder.seek_skip_loop_filter;
+    j["decoder"]["adaptive_quality"] = config.decoder.adaptive_quality;
+    j["decoder"]["codec_threading"] = json::object();
+    for (const auto& [codec, policy] : config.decoder.codec_threading) {
+        j["decoder"]["codec_threading"][codec] = to_json(policy);
+    }
     if (config.last_media_path) {
         j["last_media_path"] = config.last_media_path->string();
     }
@@ -56,6 +192,14 @@ ApplicationConfig from_json(const json& j) {
         config.playback.playback_speed = playback->value("playback_speed", config.playback.playback_speed);
         config.playback.loop_single = playback->value("loop_single", config.playback.loop_single);
         config.playback.shuffle = playback->value("shuffle", config.playback.shuffle);
+        config.playback.exact_seek = playback->value("exact_seek", config.playback.exact_seek);
+        config.playback.drop_late_frames = playback->value("drop_late_frames", config.playback.drop_late_frames);
+        config.playback.late_frame_threshold = playback->value("late_frame_threshold", config.playback.late_frame_threshold);
+        config.playback.display_sync = playback->value("display_sync", config.playback.display_sync);
+        config.playback.sync_mode = sync_mode_from_string(playback->value("sync_mode", std::string(to_string(config.playback.sync_mode))));
+        config.playback.trick_play_above_speed = playback->value("trick_play_above_speed", config.playback.trick_play_above_speed);
+        config.playback.trick_play_audio = playback->value("trick_play_audio", config.playback.trick_play_audio);
+        config.playback.reverse_buffer_mb = playback->value("reverse_buffer_mb", config.playback.reverse_buffer_mb);
     }
     if (auto video = j.find("video_adjustments"); video != j.end()) {
         config.video_adjustments.brightness = video->value("brightness", config.video_adjustments.brightness);
@@ -69,6 +213,11 @@ ApplicationConfig from_json(const json& j) {
         config.audio.muted = audio->value("muted", config.audio.muted);
         config.audio.balance = audio->value("balance", config.audio.balance);
         config.audio.audio_delay = audio->value("audio_delay", config.audio.audio_delay);
+        config.audio.buffer_ms = audio->value("buffer_ms", config.audio.buffer_ms);
+        config.audio.resample_quality = resample_quality_from_string(audio->value("resample_quality", std::string(to_string(config.audio.resample_quality))));
+        config.audio.downmix = downmix_from_string(audio->value("downmix", std::string(to_string(config.audio.downmix))));
+        config.audio.low_latency = audio->value("low_latency", config.audio.low_latency);
+        config.audio.period_frames = audio->value("period_frames", config.audio.period_frames);
     }
     if (auto subtitles = j.find("subtitles"); subtitles != j.end()) {
         config.subtitles.enabled = subtitles->value("enabled", config.subtitles.enabled);
@@ -82,6 +231,41 @@ ApplicationConfig from_json(const json& j) {
         config.network.allow_streaming = network->value("allow_streaming", config.network.allow_streaming);
         config.network.sandbox_streams = network->value("sandbox_streams", config.network.sandbox_streams);
     }
+    if (auto io = j.find("io"); io != j.end()) {
+        config.io.memory_map_local_files = io->value("memory_map_local_files", config.io.memory_map_local_files);
+    }
+    if (auto render = j.find("render"); render != j.end()) {
+        if (auto threads = render->find("conversion_threads"); threads != render->end() && threads->is_object()) {
+            std::map<int, int> parsed;
+            for (const auto& [key, count] : threads->items()) {
+                int height = -1;
+                const auto [end, error] = std::from_chars(key.data(), key.data() + key.size(), height);
+                if (error != std::errc {} || end != key.data() + key.size() || height < 0 || !count.is_number_integer() || count.get<int>() < 1) {
+                    utils::get_logger()->warn("Ignoring render.conversion_threads entry \"{}\": {}", key, count.dump());
+                    continue;
+                }
+                parsed[height] = count.get<int>();
+            }
+            // With no usable entry the defaults stay.
+            if (!parsed.empty()) {
+                config.render.conversion_threads = std::move(parsed);
+            }
+        }
+        config.render.downscale_to_output = render->value("downscale_to_output", config.render.downscale_to_output);
+        config.render.resize_cooldown_ms = render->value("resize_cooldown_ms", config.render.resize_cooldown_ms);
+        config.render.decoder_lowres = render->value("decoder_lowres", config.render.decoder_lowres);
+    }
+    if (auto decoder = j.find("decoder"); decoder != j.end()) {
+        config.decoder.threading = threading_from_json(*decoder, config.decoder.threading);
+        config.decoder.huge_page_buffers = decoder->value("huge_page_buffers", config.decoder.huge_page_buffers);
+        config.decoder.seek_skip_loop_filter = decoder->value("seek_skip_loop_filter", config.decoder.seek_skip_loop_filter);
+        config.decoder.adaptive_quality = decoder->value("adaptive_quality", config.decoder.adaptive_quality);
+        if (auto overrides = decoder->find("codec_threading"); overrides != decoder->end() && overrides->is_object()) {
+            for (const auto& [codec, policy] : overrides->items()) {
+                config.decoder.codec_threading[codec] = threading_from_json(policy, config.decoder.threading);
+            }
+        }
+    }
     if (auto path = j.find("last_media_path"); path != j.end()) {
         config.last_media_path = std::filesystem::path(path->get<std::string>());
     }
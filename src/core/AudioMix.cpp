@@ -0,0 +1,139 @@
+#include "raha/core/AudioMix.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAHA_AUDIO_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace raha::core {
+
+namespace {
+
+void mix_scalar(const float* const* inputs, std::size_t input_stride, int channels, std::size_t frames,
+                const ChannelGains& start, const ChannelGains& end, float* out) {
+    if (frames == 0) {
+        return;
+    }
+    const float scale = 1.0F / static_cast<float>(frames);
+    for (std::size_t i = 0; i < frames; ++i) {
+        const auto position = static_cast<float>(i);
+        for (int c = 0; c < channels; ++c) {
+            const float gain = start[c] + (end[c] - start[c]) * scale * position;
+            out[i * channels + c] = inputs[c][i * input_stride] * gain;
+        }
+    }
+}
+
+#if defined(RAHA_AUDIO_SSE2)
+// Mono, stereo planar and stereo interleaved cover nearly all material; everything else
+// falls back to the scalar loop.
+void mix_sse2(const float* const* inputs, std::size_t input_stride, int channels, std::size_t frames,
+              const ChannelGains& start, const ChannelGains& end, float* out) {
+    if (frames == 0) {
+        return;
+    }
+    const float scale = 1.0F / static_cast<float>(frames);
+    std::size_t i = 0;
+    if (channels == 1 && input_stride == 1) {
+        const float* in = inputs[0];
+        const __m128 base = _mm_set1_ps(start[0]);
+        const __m128 step = _mm_set1_ps((end[0] - start[0]) * scale);
+        __m128 position = _mm_setr_ps(0.0F, 1.0F, 2.0F, 3.0F);
+        const __m128 four = _mm_set1_ps(4.0F);
+        for (; i + 4 <= frames; i += 4) {
+            const __m128 gain = _mm_add_ps(base, _mm_mul_ps(step, position));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), gain));
+            position = _mm_add_ps(position, four);
+        }
+    } else if (channels == 2 && input_stride == 1) {
+        const float* left = inputs[0];
+        const float* right = inputs[1];
+        const __m128 left_base = _mm_set1_ps(start[0]);
+        const __m128 right_base = _mm_set1_ps(start[1]);
+        const __m128 left_step = _mm_set1_ps((end[0] - start[0]) * scale);
+        const __m128 right_step = _mm_set1_ps((end[1] - start[1]) * scale);
+        __m128 position = _mm_setr_ps(0.0F, 1.0F, 2.0F, 3.0F);
+        const __m128 four = _mm_set1_ps(4.0F);
+        for (; i + 4 <= frames; i += 4) {
+            const __m128 l = _mm_mul_ps(_mm_loadu_ps(left + i), _mm_add_ps(left_base, _mm_mul_ps(left_step, position)));
+            const __m128 r = _mm_mul_ps(_mm_loadu_ps(right + i), _mm_add_ps(right_base, _mm_mul_ps(right_step, position)));
+            _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+            position = _mm_add_ps(position, four);
+        }
+    } else if (channels == 2 && input_stride == 2 && inputs[1] == inputs[0] + 1) {
+        // Two frames per vector: gains are laid out L R L R.
+        const float* in = inputs[0];
+        const __m128 base = _mm_setr_ps(start[0], start[1], start[0], start[1]);
+        const __m128 step = _mm_setr_ps((end[0] - start[0]) * scale, (end[1] - start[1]) * scale,
+                                        (end[0] - start[0]) * scale, (end[1] - start[1]) * scale);
+        __m128 position = _mm_setr_ps(0.0F, 0.0F, 1.0F, 1.0F);
+        const __m128 two = _mm_set1_ps(2.0F);
+        for (; i + 2 <= frames; i += 2) {
+            const __m128 gain = _mm_add_ps(base, _mm_mul_ps(step, position));
+            _mm_storeu_ps(out + 2 * i, _mm_mul_ps(_mm_loadu_ps(in + 2 * i), gain));
+            position = _mm_add_ps(position, two);
+        }
+    }
+    // The tail continues the same ramp.
+    for (; i < frames; ++i) {
+        const auto position = static_cast<float>(i);
+        for (int c = 0; c < channels; ++c) {
+            const float gain = start[c] + (end[c] - start[c]) * scale * position;
+            out[i * channels + c] = inputs[c][i * input_stride] * gain;
+        }
+    }
+}
+#endif
+
+} // namespace
+
+ChannelGains channel_gains(float volume, float balance, bool muted) {
+    ChannelGains gains;
+    const float gain = muted ? 0.0F : std::clamp(volume, 0.0F, 1.0F);
+    gains.fill(gain);
+    balance = std::clamp(balance, -1.0F, 1.0F);
+    gains[0] = gain * std::min(1.0F, 1.0F - balance);
+    gains[1] = gain * std::min(1.0F, 1.0F + balance);
+    return gains;
+}
+
+bool unity_gains(const ChannelGains& gains, int channels) {
+    return std::all_of(gains.begin(), gains.begin() + std::clamp(channels, 0, max_mix_channels), [](float gain) { return gain == 1.0F; });
+}
+
+AudioKernel detect_audio_kernel() {
+#if defined(RAHA_AUDIO_SSE2)
+    return AudioKernel::Sse2;
+#else
+    return AudioKernel::Scalar;
+#endif
+}
+
+MixFunction mix_function(AudioKernel kernel) {
+    switch (kernel) {
+    case AudioKernel::Scalar:
+        return &mix_scalar;
+    case AudioKernel::Sse2:
+#if defined(RAHA_AUDIO_SSE2)
+        return &mix_sse2;
+#else
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+const char* to_string(AudioKernel kernel) {
+    switch (kernel) {
+    case AudioKernel::Scalar:
+        return "scalar";
+    case AudioKernel::Sse2:
+        return "sse2";
+    }
+    return "scalar";
+}
+
+} // namespace raha::core
@@ -8,16 +8,114 @@ extern "C" {
 }
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
 #include <stdexcept>
-#include <vector>
 
 namespace raha::core {
 
-AudioRenderer::AudioRenderer() = default;
+namespace {
+// The ring holds at least a second so refill bursts never hit its capacity.
+constexpr double min_ring_seconds = 1.0;
+constexpr auto decoder_poll_interval = std::chrono::milliseconds(5);
+// Output whose media time strays further than this from the anchor gets a new one.
+constexpr double anchor_tolerance = 0.001;
+constexpr int default_period_frames = 1024;
+constexpr int low_latency_period_frames = 256;
+// Low-latency mode keeps this many periods queued ahead of the device.
+constexpr int low_latency_periods = 4;
+// The device latency is averaged over this window after it starts; the first half
+// second covers backends that fill several buffers at once.
+constexpr double latency_settle_seconds = 0.5;
+constexpr double latency_window_seconds = 3.0;
+
+double steady_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int period_frames(const AudioSettings& settings) {
+    const int frames = settings.period_frames > 0 ? settings.period_frames
+        : settings.low_latency ? low_latency_period_frames : default_period_frames;
+    // Several SDL backends require a power of two.
+    return static_cast<int>(std::bit_ceil(static_cast<unsigned>(std::clamp(frames, 64, 8192))));
+}
+
+// SDL's channel order for each channel count, as an FFmpeg layout.
+AVChannelLayout sdl_channel_layout(int channels) {
+    uint64_t mask = 0;
+    switch (channels) {
+    case 1:
+        mask = AV_CH_LAYOUT_MONO;
+        break;
+    case 2:
+        mask = AV_CH_LAYOUT_STEREO;
+        break;
+    case 3:
+        mask = AV_CH_LAYOUT_2POINT1;
+        break;
+    case 4:
+        mask = AV_CH_LAYOUT_QUAD;
+        break;
+    case 5:
+        mask = AV_CH_FRONT_LEFT | AV_CH_FRONT_RIGHT | AV_CH_LOW_FREQUENCY | AV_CH_BACK_LEFT | AV_CH_BACK_RIGHT;
+        break;
+    case 6:
+        mask = AV_CH_LAYOUT_5POINT1;
+        break;
+    case 7:
+        mask = AV_CH_LAYOUT_6POINT1;
+        break;
+    case 8:
+        mask = AV_CH_LAYOUT_7POINT1;
+        break;
+    default:
+        break;
+    }
+    AVChannelLayout layout {};
+    if (mask != 0) {
+        av_channel_layout_from_mask(&layout, mask);
+    } else {
+        av_channel_layout_default(&layout, channels);
+    }
+    return layout;
+}
+
+// Only consulted when the device rate differs from the stream's.
+bool set_resample_quality(SwrContext* ctx, ResampleQuality quality) {
+    switch (quality) {
+    case ResampleQuality::Fast:
+        return av_opt_set_int(ctx, "filter_size", 8, 0) >= 0 && av_opt_set_int(ctx, "phase_shift", 6, 0) >= 0
+            && av_opt_set_int(ctx, "linear_interp", 1, 0) >= 0;
+    case ResampleQuality::High:
+        return av_opt_set_int(ctx, "filter_size", 64, 0) >= 0 && av_opt_set_int(ctx, "phase_shift", 12, 0) >= 0
+            && av_opt_set_double(ctx, "cutoff", 0.98, 0) >= 0;
+    case ResampleQuality::Balanced:
+        break;
+    }
+    return true;
+}
+
+// Only consulted when the device has fewer channels than the stream. swresample does not
+// normalize float output by default, so the normalized modes cap each output at unity.
+bool set_downmix(SwrContext* ctx, DownmixMode mode) {
+    constexpr double minus_3db = 0.7071067811865476;
+    const bool dialogue = mode == DownmixMode::Dialogue;
+    return av_opt_set_double(ctx, "center_mix_level", dialogue ? 1.0 : minus_3db, 0) >= 0
+        && av_opt_set_double(ctx, "surround_mix_level", dialogue ? 0.5 : minus_3db, 0) >= 0
+        && av_opt_set_double(ctx, "lfe_mix_level", 0.0, 0) >= 0
+        && av_opt_set_double(ctx, "rematrix_maxval", mode == DownmixMode::Itu ? 0.0 : 1.0, 0) >= 0;
+}
+
+} // namespace
+
+AudioRenderer::AudioRenderer() : mix_(mix_function(detect_audio_kernel())) {}
 AudioRenderer::~AudioRenderer() { shutdown(); }
 
-bool AudioRenderer::initialize(AVCodecContext* audio_ctx) {
-    if (!audio_ctx) {
+bool AudioRenderer::initialize(AVCodecContext* audio_ctx, const AudioSettings& settings, FrameSource source) {
+    shutdown();
+    if (!audio_ctx || !source) {
         return false;
     }
     if (SDL_WasInit(SDL_INIT_AUDIO) == 0) {
@@ -25,51 +123,152 @@ bool AudioRenderer::initialize(AVCodecContext* audio_ctx) {
             throw std::runtime_error(SDL_GetError());
         }
     }
-    if (!configure_device(audio_ctx)) {
+    if (!configure_device(audio_ctx, settings)) {
         return false;
     }
-    resampler_ = make_resampler(audio_ctx);
+    resampler_ = make_resampler(audio_ctx, settings);
     if (!resampler_) {
+        shutdown();
         return false;
     }
-    SDL_PauseAudioDevice(device_, 0);
+    time_base_ = audio_ctx->pkt_timebase.num > 0 ? audio_ctx->pkt_timebase : AVRational {1, audio_ctx->sample_rate};
+    // SDL plays one buffer while the callback fills the next, so about two periods sit
+    // between the callback and the speaker until the callback measures it.
+    device_latency_ = 2.0 * obtained_spec_.samples / obtained_spec_.freq;
+    latency_measured_ = false;
+    latency_restart_ = true;
+    target_seconds_ = std::clamp(settings.buffer_ms, 20, 1000) / 1000.0;
+    if (settings.low_latency) {
+        const double periods = static_cast<double>(low_latency_periods) * obtained_spec_.samples / obtained_spec_.freq;
+        target_seconds_ = std::min(target_seconds_, std::max(0.02, periods));
+    }
+    const auto samples_per_second = static_cast<std::size_t>(obtained_spec_.freq) * obtained_spec_.channels;
+    ring_.reset(static_cast<std::size_t>(samples_per_second * std::max(min_ring_seconds, 2.0 * target_seconds_)));
+    scratch_.assign(samples_per_second / 10, 0.0F);
+    stretcher_.configure(obtained_spec_.freq, obtained_spec_.channels);
+    stretcher_.set_speed(speed_.load());
+    source_ = std::move(source);
+    volume_ = std::clamp(settings.volume, 0.0F, 1.0F);
+    muted_ = settings.muted;
+    balance_ = std::clamp(settings.balance, -1.0F, 1.0F);
+    applied_gains_ = channel_gains(volume_, balance_, muted_);
+    underruns_ = 0;
+    overruns_ = 0;
+    primed_ = false;
+    has_anchor_ = false;
+    anchor_count_ = 0;
+    has_clock_ = false;
+    resample_rate_ = 1.0;
+    pending_shift_ = 0.0;
+    compensation_residual_ = 0.0;
+    compensating_ = false;
+    skip_frames_ = 0;
+    refill_stop_ = false;
+    refill_thread_ = std::thread([this] { refill_loop(); });
     return true;
 }
 
 void AudioRenderer::shutdown() {
+    if (refill_thread_.joinable()) {
+        {
+            std::scoped_lock lock(refill_mutex_);
+            refill_stop_ = true;
+        }
+        refill_cv_.notify_all();
+        refill_thread_.join();
+    }
     if (device_ != 0) {
         SDL_CloseAudioDevice(device_);
         device_ = 0;
     }
     resampler_.reset();
+    av_channel_layout_uninit(&device_layout_);
+    source_ = nullptr;
 }
 
-void AudioRenderer::queue_frame(const AVFrame* frame) {
-    if (!frame || !resampler_ || device_ == 0) {
+void AudioRenderer::clear() {
+    if (device_ == 0) {
         return;
     }
-    int out_samples = swr_get_out_samples(resampler_.get(), frame->nb_samples);
-    std::vector<float> buffer(static_cast<std::size_t>(out_samples) * obtained_spec_.channels);
-    uint8_t* out_planes[] = {reinterpret_cast<uint8_t*>(buffer.data())};
-    const uint8_t** in_data = const_cast<const uint8_t**>(frame->extended_data);
-    int converted = swr_convert(resampler_.get(), out_planes, out_samples, in_data, frame->nb_samples);
-    if (converted < 0) {
+    // Both ring users are held off: the refill thread by its mutex, the callback by the
+    // device lock.
+    std::scoped_lock lock(refill_mutex_);
+    SDL_LockAudioDevice(device_);
+    ring_.clear();
+    primed_ = false;
+    anchor_count_ = 0;
+    has_clock_ = false;
+    SDL_UnlockAudioDevice(device_);
+    has_anchor_ = false;
+    stretcher_.reset();
+    // Samples buffered inside the resampler belong to the old position as well. This
+    // also ends any compensation in progress.
+    swr_init(resampler_.get());
+    pending_shift_ = 0.0;
+    compensation_residual_ = 0.0;
+    compensating_ = false;
+    skip_frames_ = 0;
+    refill_cv_.notify_all();
+}
+
+void AudioRenderer::set_paused(bool paused) {
+    if (device_ == 0) {
         return;
     }
-    std::size_t total_samples = static_cast<std::size_t>(converted) * obtained_spec_.channels;
-    float applied_volume = muted_.load() ? 0.0F : volume_.load();
-    if (applied_volume != 1.0F) {
-        for (std::size_t i = 0; i < total_samples; ++i) {
-            buffer[i] *= applied_volume;
-        }
+    // The refill thread keeps running, so playback resumes from a full buffer.
+    SDL_PauseAudioDevice(device_, paused ? 1 : 0);
+    if (paused) {
+        // Where the device stopped is unknown; the clock resumes with the next callback.
+        has_clock_ = false;
+    } else if (!latency_measured_) {
+        latency_restart_ = true;
     }
-    SDL_QueueAudio(device_, buffer.data(), total_samples * sizeof(float));
 }
 
-void AudioRenderer::clear() {
+std::optional<double> AudioRenderer::clock() const {
+    if (device_ == 0 || !has_clock_.load(std::memory_order_acquire)) {
+        return std::nullopt;
+    }
+    // Between callbacks the device keeps playing in real time, but never past what it got.
+    const double latency = device_latency_.load(std::memory_order_relaxed);
+    const double elapsed = std::clamp(steady_seconds() - callback_time_.load(std::memory_order_relaxed), 0.0, latency);
+    return callback_pts_.load(std::memory_order_relaxed) + (elapsed - latency) * callback_speed_.load(std::memory_order_relaxed);
+}
+
+void AudioRenderer::set_resample_rate(double rate) {
+    resample_rate_.store(rate > 0.0 ? rate : 1.0, std::memory_order_relaxed);
+}
+
+void AudioRenderer::set_speed(double speed) {
+    speed_.store(speed > 0.0 ? speed : 1.0, std::memory_order_relaxed);
+}
+
+void AudioRenderer::shift(double seconds) {
+    pending_shift_.fetch_add(seconds, std::memory_order_relaxed);
+}
+
+double AudioRenderer::queued_seconds() const {
+    if (device_ == 0 || obtained_spec_.freq <= 0 || obtained_spec_.channels == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(ring_.size()) / (static_cast<double>(obtained_spec_.freq) * obtained_spec_.channels);
+}
+
+AudioBufferStats AudioRenderer::stats() const {
+    AudioBufferStats stats;
+    stats.underruns = underruns_.load();
+    stats.overruns = overruns_.load();
+    stats.fill_seconds = queued_seconds();
+    stats.stretch = stretch_algorithm_.load();
+    stats.stretch_load = stretch_load_.load();
     if (device_ != 0) {
-        SDL_ClearQueuedAudio(device_);
+        stats.output_latency = device_latency_.load();
+        stats.latency_measured = latency_measured_.load();
+        stats.period_frames = obtained_spec_.samples;
+        stats.device_rate = obtained_spec_.freq;
+        stats.device_channels = obtained_spec_.channels;
     }
+    return stats;
 }
 
 void AudioRenderer::set_volume(float volume) {
@@ -80,37 +279,355 @@ void AudioRenderer::set_muted(bool muted) {
     muted_.store(muted);
 }
 
-bool AudioRenderer::configure_device(const AVCodecContext* audio_ctx) {
+void AudioRenderer::set_balance(float balance) {
+    balance_.store(std::clamp(balance, -1.0F, 1.0F));
+}
+
+void AudioRenderer::set_silenced(bool silenced) {
+    silenced_.store(silenced);
+}
+
+void AudioRenderer::audio_callback(void* userdata, Uint8* stream, int len) {
+    auto* self = static_cast<AudioRenderer*>(userdata);
+    auto* out = reinterpret_cast<float*>(stream);
+    const std::size_t wanted = static_cast<std::size_t>(len) / sizeof(float);
+    const std::size_t got = self->ring_.read(out, wanted);
+    if (got < wanted) {
+        std::fill(out + got, out + wanted, 0.0F);
+        // One count per starvation; the next write re-arms it.
+        if (self->primed_.exchange(false, std::memory_order_relaxed)) {
+            ++self->underruns_;
+        }
+    }
+    self->measure_latency(wanted / self->obtained_spec_.channels);
+    const std::size_t frame = self->ring_.consumed() / self->obtained_spec_.channels;
+    if (auto anchor = self->load_anchor(frame)) {
+        const double rate = self->obtained_spec_.freq;
+        const double pts = frame >= anchor->frame
+            ? anchor->pts + static_cast<double>(frame - anchor->frame) * anchor->speed / rate
+            : anchor->pts - static_cast<double>(anchor->frame - frame) * anchor->previous_speed / rate;
+        self->callback_pts_.store(pts, std::memory_order_relaxed);
+        self->callback_speed_.store(anchor->speed, std::memory_order_relaxed);
+        self->callback_time_.store(steady_seconds(), std::memory_order_relaxed);
+        self->has_clock_.store(true, std::memory_order_release);
+    }
+    // Applied here rather than at conversion so volume changes are heard immediately;
+    // the ramp from the previous gains spreads a change over this buffer.
+    const int channels = self->obtained_spec_.channels;
+    const auto target = channel_gains(self->volume_.load(std::memory_order_relaxed), self->balance_.load(std::memory_order_relaxed),
+                                      self->muted_.load(std::memory_order_relaxed) || self->silenced_.load(std::memory_order_relaxed));
+    if (channels <= max_mix_channels && !(unity_gains(self->applied_gains_, channels) && unity_gains(target, channels))) {
+        std::array<const float*, max_mix_channels> inputs {};
+        for (int c = 0; c < channels; ++c) {
+            inputs[c] = out + c;
+        }
+        self->mix_(inputs.data(), channels, channels, got / channels, self->applied_gains_, target, out);
+    }
+    self->applied_gains_ = target;
+}
+
+void AudioRenderer::measure_latency(std::size_t frames) {
+    if (latency_measured_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const double now = steady_seconds();
+    if (latency_restart_.exchange(false, std::memory_order_relaxed)) {
+        latency_origin_ = now;
+        latency_delivered_ = 0;
+        latency_sum_ = 0.0;
+        latency_samples_ = 0;
+    }
+    // Silence counts too: the device plays whatever it is given.
+    latency_delivered_ += frames;
+    const double running = now - latency_origin_;
+    if (running < latency_settle_seconds) {
+        return;
+    }
+    if (running <= latency_window_seconds) {
+        latency_sum_ += static_cast<double>(latency_delivered_) / obtained_spec_.freq - running;
+        ++latency_samples_;
+        return;
+    }
+    if (latency_samples_ > 0) {
+        // The device holds at least the buffer it is playing.
+        const double period = static_cast<double>(obtained_spec_.samples) / obtained_spec_.freq;
+        device_latency_.store(std::max(period, latency_sum_ / latency_samples_), std::memory_order_relaxed);
+        latency_measured_.store(true, std::memory_order_relaxed);
+    }
+}
+
+void AudioRenderer::refill_loop() {
+    std::unique_lock lock(refill_mutex_);
+    while (!refill_stop_) {
+        const double fill = queued_seconds();
+        if (fill >= target_seconds_) {
+            // Sleep until about half the target has played out.
+            refill_cv_.wait_for(lock, std::chrono::duration<double>(fill - target_seconds_ / 2.0));
+            continue;
+        }
+        auto frame = source_();
+        if (!frame) {
+            refill_cv_.wait_for(lock, decoder_poll_interval);
+            continue;
+        }
+        write_frame(frame->get());
+    }
+}
+
+void AudioRenderer::write_frame(const AVFrame* frame) {
+    const std::size_t channels = obtained_spec_.channels;
+    const double rate = obtained_spec_.freq;
+    const double speed = speed_.load(std::memory_order_relaxed);
+    stretcher_.set_speed(speed);
+    if (const double shift = pending_shift_.exchange(0.0, std::memory_order_relaxed); shift > 0.0) {
+        skip_frames_ += static_cast<std::size_t>(shift * rate);
+    } else if (shift < 0.0) {
+        // The video clock covers the gap at `speed`, so the silence is that much shorter.
+        // The audio clock holds over it at the time of the sample that follows; the next
+        // frame's pts moves it on again.
+        if (has_anchor_) {
+            const std::size_t position = ring_.produced() / channels;
+            const double held = anchor_.pts + static_cast<double>(position - anchor_.frame) * anchor_.speed / rate;
+            publish_anchor({position, held, 0.0, anchor_.speed});
+        }
+        write_silence(static_cast<std::size_t>(-shift * rate / speed));
+    }
+    apply_compensation(frame);
+
+    int64_t delay = 0;
+    int converted = 0;
+    if (auto direct = convert_direct(frame)) {
+        converted = static_cast<int>(*direct);
+    } else {
+        // The first sample this conversion returns is the oldest one the resampler still holds.
+        delay = swr_get_delay(resampler_.get(), obtained_spec_.freq);
+        const int out_samples = swr_get_out_samples(resampler_.get(), frame->nb_samples);
+        if (out_samples <= 0) {
+            return;
+        }
+        const std::size_t needed = static_cast<std::size_t>(out_samples) * channels;
+        if (scratch_.size() < needed) {
+            scratch_.resize(needed);
+        }
+        uint8_t* out_planes[] = {reinterpret_cast<uint8_t*>(scratch_.data())};
+        const uint8_t** in_data = const_cast<const uint8_t**>(frame->extended_data);
+        converted = swr_convert(resampler_.get(), out_planes, out_samples, in_data, frame->nb_samples);
+    }
+    if (converted <= 0) {
+        return;
+    }
+    const std::size_t skipped = std::min(skip_frames_, static_cast<std::size_t>(converted));
+    skip_frames_ -= skipped;
+    if (skipped == static_cast<std::size_t>(converted)) {
+        return;
+    }
+    // What the stretcher emits next started this many frames before the current input.
+    const double stretch_delay = stretcher_.buffered_frames();
+    const std::size_t stretched = stretcher_.process(scratch_.data() + skipped * channels, static_cast<std::size_t>(converted) - skipped, stretched_);
+    const auto stretch_stats = stretcher_.stats();
+    stretch_algorithm_.store(stretch_stats.algorithm, std::memory_order_relaxed);
+    stretch_load_.store(stretch_stats.load(), std::memory_order_relaxed);
+
+    std::optional<double> pts;
+    if (frame->pts != AV_NOPTS_VALUE) {
+        pts = frame->pts * av_q2d(time_base_) + (static_cast<double>(skipped) - delay - stretch_delay) / rate;
+    }
+    write_output(stretched_.data(), stretched, pts);
+}
+
+std::optional<std::size_t> AudioRenderer::convert_direct(const AVFrame* frame) {
+    const int channels = obtained_spec_.channels;
+    const auto format = static_cast<AVSampleFormat>(frame->format);
+    if ((format != AV_SAMPLE_FMT_FLTP && format != AV_SAMPLE_FMT_FLT) || frame->sample_rate != obtained_spec_.freq
+        || av_channel_layout_compare(&frame->ch_layout, &device_layout_) != 0 || channels > max_mix_channels || compensating_
+        || swr_get_delay(resampler_.get(), obtained_spec_.freq) != 0) {
+        return std::nullopt;
+    }
+    const auto frames = static_cast<std::size_t>(frame->nb_samples);
+    const std::size_t needed = frames * channels;
+    if (scratch_.size() < needed) {
+        scratch_.resize(needed);
+    }
+    const auto* data = reinterpret_cast<const float* const*>(frame->extended_data);
+    if (format == AV_SAMPLE_FMT_FLT) {
+        std::copy(data[0], data[0] + needed, scratch_.data());
+        return frames;
+    }
+    // Gains are applied at the device, so interleaving runs at unity.
+    ChannelGains unity;
+    unity.fill(1.0F);
+    mix_(data, 1, channels, frames, unity, unity, scratch_.data());
+    return frames;
+}
+
+void AudioRenderer::write_output(const float* samples, std::size_t frames, std::optional<double> pts) {
+    if (frames == 0) {
+        return;
+    }
+    const std::size_t channels = obtained_spec_.channels;
+    const std::size_t position = ring_.produced() / channels;
+    if (pts) {
+        const double speed = stretcher_.speed();
+        const double expected = anchor_.pts + static_cast<double>(position - anchor_.frame) * anchor_.speed / obtained_spec_.freq;
+        if (!has_anchor_ || anchor_.speed != speed || std::abs(expected - *pts) > anchor_tolerance) {
+            ClockAnchor anchor {position, *pts, speed, has_anchor_ ? anchor_.speed : speed};
+            publish_anchor(anchor);
+        }
+    }
+    const std::size_t total = frames * channels;
+    const std::size_t written = ring_.write(samples, total);
+    if (written < total) {
+        ++overruns_;
+    }
+    if (written > 0) {
+        primed_.store(true, std::memory_order_relaxed);
+    }
+}
+
+void AudioRenderer::publish_anchor(const ClockAnchor& anchor) {
+    anchor_ = anchor;
+    has_anchor_ = true;
+    // The slot of the oldest retained anchor is reused.
+    const uint64_t index = anchor_count_.load(std::memory_order_relaxed);
+    AnchorSlot& slot = anchor_slots_[index % anchor_history];
+    const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.index.store(index, std::memory_order_relaxed);
+    slot.frame.store(anchor.frame, std::memory_order_relaxed);
+    slot.pts.store(anchor.pts, std::memory_order_relaxed);
+    slot.speed.store(anchor.speed, std::memory_order_relaxed);
+    slot.previous_speed.store(anchor.previous_speed, std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    anchor_count_.store(index + 1, std::memory_order_release);
+}
+
+std::optional<AudioRenderer::ClockAnchor> AudioRenderer::load_anchor(std::size_t frame) const {
+    // The writer only holds a sequence odd for six stores; a slot that keeps colliding,
+    // or was reused for a newer anchor meanwhile, is skipped.
+    auto read = [this](uint64_t index) -> std::optional<ClockAnchor> {
+        const AnchorSlot& slot = anchor_slots_[index % anchor_history];
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if ((before & 1U) != 0) {
+                continue;
+            }
+            const uint64_t held = slot.index.load(std::memory_order_relaxed);
+            ClockAnchor anchor {
+                slot.frame.load(std::memory_order_relaxed),
+                slot.pts.load(std::memory_order_relaxed),
+                slot.speed.load(std::memory_order_relaxed),
+                slot.previous_speed.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                return held == index ? std::optional(anchor) : std::nullopt;
+            }
+        }
+        return std::nullopt;
+    };
+    const uint64_t count = anchor_count_.load(std::memory_order_acquire);
+    const uint64_t oldest = count > anchor_history ? count - anchor_history : 0;
+    std::optional<ClockAnchor> covering;
+    for (uint64_t index = count; index > oldest; --index) {
+        if (auto anchor = read(index - 1)) {
+            covering = anchor;
+            if (anchor->frame <= frame) {
+                break;
+            }
+        }
+    }
+    return covering;
+}
+
+void AudioRenderer::write_silence(std::size_t frames) {
+    std::fill(scratch_.begin(), scratch_.end(), 0.0F);
+    std::size_t remaining = frames * obtained_spec_.channels;
+    while (remaining > 0) {
+        const std::size_t written = ring_.write(scratch_.data(), std::min(remaining, scratch_.size()));
+        if (written == 0) {
+            break;
+        }
+        remaining -= written;
+    }
+}
+
+void AudioRenderer::apply_compensation(const AVFrame* frame) {
+    const double rate = resample_rate_.load(std::memory_order_relaxed);
+    if (rate == 1.0) {
+        if (compensating_) {
+            swr_set_compensation(resampler_.get(), 0, 0);
+            compensating_ = false;
+            compensation_residual_ = 0.0;
+        }
+        return;
+    }
+    if (frame->sample_rate <= 0) {
+        return;
+    }
+    // Corrections of a few hundred ppm are a fraction of a sample per frame; the
+    // remainder is carried over so they are not rounded away.
+    const double out_frames = static_cast<double>(frame->nb_samples) * obtained_spec_.freq / frame->sample_rate;
+    const double wanted = out_frames / rate - out_frames + compensation_residual_;
+    const auto delta = static_cast<int>(std::lround(wanted));
+    compensation_residual_ = wanted - delta;
+    if (swr_set_compensation(resampler_.get(), delta, static_cast<int>(std::lround(out_frames))) >= 0) {
+        compensating_ = true;
+    }
+}
+
+bool AudioRenderer::configure_device(const AVCodecContext* audio_ctx, const AudioSettings& settings) {
+    // Ask for the device's own rate and at most its channel count, and accept whatever it
+    // offers instead: SDL would otherwise convert a second time behind the resampler.
+    int rate = audio_ctx->sample_rate;
+    int channels = audio_ctx->ch_layout.nb_channels;
+#if SDL_VERSION_ATLEAST(2, 24, 0)
+    SDL_AudioSpec native {};
+    if (SDL_GetDefaultAudioInfo(nullptr, &native, 0) == 0) {
+        rate = native.freq > 0 ? native.freq : rate;
+        channels = native.channels > 0 ? std::min<int>(channels, native.channels) : channels;
+    }
+#endif
     SDL_AudioSpec desired {};
-    desired.freq = audio_ctx->sample_rate;
+    desired.freq = rate;
     desired.format = AUDIO_F32SYS;
-    desired.channels = static_cast<Uint8>(audio_ctx->ch_layout.nb_channels);
-    desired.samples = 4096;
-    desired.callback = nullptr;
+    desired.channels = static_cast<Uint8>(std::clamp(channels, 1, max_mix_channels));
+    desired.samples = static_cast<Uint16>(period_frames(settings));
+    desired.callback = &AudioRenderer::audio_callback;
+    desired.userdata = this;
 
-    device_ = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained_spec_, 0);
+    const int allowed = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE;
+    device_ = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained_spec_, allowed);
     if (device_ == 0) {
         utils::get_logger()->error("Failed to open audio device: {}", SDL_GetError());
         return false;
     }
+    device_layout_ = sdl_channel_layout(obtained_spec_.channels);
+    utils::get_logger()->info("Audio device: {} Hz, {} channels, {} frame periods (stream {} Hz, {} channels)",
+                              obtained_spec_.freq, obtained_spec_.channels, obtained_spec_.samples,
+                              audio_ctx->sample_rate, audio_ctx->ch_layout.nb_channels);
     return true;
 }
 
-SwrContextPtr AudioRenderer::make_resampler(AVCodecContext* audio_ctx) {
+SwrContextPtr AudioRenderer::make_resampler(const AVCodecContext* audio_ctx, const AudioSettings& settings) {
     SwrContext* ctx = swr_alloc();
     if (!ctx) {
         return nullptr;
     }
-    if (av_opt_set_chlayout(ctx, "in_chlayout", &audio_ctx->ch_layout, 0) < 0 ||
-        av_opt_set_chlayout(ctx, "out_chlayout", &audio_ctx->ch_layout, 0) < 0 ||
-        av_opt_set_int(ctx, "in_sample_rate", audio_ctx->sample_rate, 0) < 0 ||
-        av_opt_set_int(ctx, "out_sample_rate", audio_ctx->sample_rate, 0) < 0 ||
-        av_opt_set_sample_fmt(ctx, "in_sample_fmt", static_cast<AVSampleFormat>(audio_ctx->sample_fmt), 0) < 0 ||
-        av_opt_set_sample_fmt(ctx, "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0) < 0) {
-        swr_free(&ctx);
-        return nullptr;
+    AVChannelLayout in_layout {};
+    if (audio_ctx->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC) {
+        av_channel_layout_default(&in_layout, audio_ctx->ch_layout.nb_channels);
+    } else {
+        av_channel_layout_copy(&in_layout, &audio_ctx->ch_layout);
     }
-    if (swr_init(ctx) < 0) {
+    const bool configured = av_opt_set_chlayout(ctx, "in_chlayout", &in_layout, 0) >= 0 &&
+        av_opt_set_chlayout(ctx, "out_chlayout", &device_layout_, 0) >= 0 &&
+        av_opt_set_int(ctx, "in_sample_rate", audio_ctx->sample_rate, 0) >= 0 &&
+        av_opt_set_int(ctx, "out_sample_rate", obtained_spec_.freq, 0) >= 0 &&
+        av_opt_set_sample_fmt(ctx, "in_sample_fmt", static_cast<AVSampleFormat>(audio_ctx->sample_fmt), 0) >= 0 &&
+        av_opt_set_sample_fmt(ctx, "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0) >= 0 &&
+        set_resample_quality(ctx, settings.resample_quality) && set_downmix(ctx, settings.downmix);
+    av_channel_layout_uninit(&in_layout);
+    if (!configured || swr_init(ctx) < 0) {
         swr_free(&ctx);
         return nullptr;
     }
@@ -0,0 +1,55 @@
+#include "raha/core/AudioRingBuffer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace raha::core {
+
+AudioRingBuffer::AudioRingBuffer(std::size_t capacity) {
+    reset(capacity);
+}
+
+void AudioRingBuffer::reset(std::size_t capacity) {
+    capacity_ = capacity > 0 ? std::bit_ceil(capacity) : 0;
+    mask_ = capacity_ > 0 ? capacity_ - 1 : 0;
+    data_ = capacity_ > 0 ? std::make_unique<float[]>(capacity_) : nullptr;
+    clear();
+}
+
+void AudioRingBuffer::clear() {
+    write_index_.store(0, std::memory_order_relaxed);
+    read_index_.store(0, std::memory_order_relaxed);
+}
+
+std::size_t AudioRingBuffer::write(const float* samples, std::size_t count) {
+    const std::size_t write = write_index_.load(std::memory_order_relaxed);
+    const std::size_t read = read_index_.load(std::memory_order_acquire);
+    count = std::min(count, capacity_ - (write - read));
+    const std::size_t offset = write & mask_;
+    const std::size_t first = std::min(count, capacity_ - offset);
+    std::memcpy(data_.get() + offset, samples, first * sizeof(float));
+    std::memcpy(data_.get(), samples + first, (count - first) * sizeof(float));
+    write_index_.store(write + count, std::memory_order_release);
+    return count;
+}
+
+std::size_t AudioRingBuffer::read(float* samples, std::size_t count) {
+    const std::size_t read = read_index_.load(std::memory_order_relaxed);
+    const std::size_t write = write_index_.load(std::memory_order_acquire);
+    count = std::min(count, write - read);
+    const std::size_t offset = read & mask_;
+    const std::size_t first = std::min(count, capacity_ - offset);
+    std::memcpy(samples, data_.get() + offset, first * sizeof(float));
+    std::memcpy(samples + first, data_.get(), (count - first) * sizeof(float));
+    read_index_.store(read + count, std::memory_order_release);
+    return count;
+}
+
+std::size_t AudioRingBuffer::size() const {
+    const std::size_t read = read_index_.load(std::memory_order_acquire);
+    const std::size_t write = write_index_.load(std::memory_order_acquire);
+    return write - read;
+}
+
+} // namespace raha::core
@@ -0,0 +1,339 @@
+#include "raha/core/ColorConvert.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAHA_COLOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace raha::core {
+
+#if defined(RAHA_HAS_AVX2_KERNEL)
+// ColorConvertAvx2.cpp is the only file built with AVX2 code generation.
+void convert_row_avx2(const ColorLuts& luts, const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width);
+#endif
+
+namespace {
+constexpr int fraction_bits = 6;
+constexpr int coefficient_bits = 12;
+constexpr int chroma_shift = coefficient_bits - fraction_bits;
+
+int16_t saturate16(int value) {
+    return static_cast<int16_t>(std::clamp(value, -32768, 32767));
+}
+
+int16_t to_fixed(double value, int bits = fraction_bits) {
+    return saturate16(static_cast<int>(std::lround(std::ldexp(value, bits))));
+}
+
+// The rounded Q6 chroma contribution of one u/v pair; the vector kernels compute the
+// same with madd, a rounding add, an arithmetic shift and a saturating pack.
+int16_t chroma_term(int du, int dv, int16_t cu, int16_t cv) {
+    return saturate16((du * cu + dv * cv + (1 << (chroma_shift - 1))) >> chroma_shift);
+}
+
+uint8_t to_channel(int16_t luma, int16_t chroma) {
+    return static_cast<uint8_t>(std::clamp(saturate16(luma + chroma) >> fraction_bits, 0, 255));
+}
+
+void convert_row_scalar(const ColorLuts& luts, const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width) {
+    for (int x = 0; x < width; ++x) {
+        const int c = x >> 1;
+        const int du = u[c] - 128;
+        const int dv = v[c] - 128;
+        const auto luma = static_cast<int16_t>(luts.y[y[x]]);
+        dst[4 * x + 0] = to_channel(luma, chroma_term(du, dv, luts.bu, 0));
+        dst[4 * x + 1] = to_channel(luma, chroma_term(du, dv, luts.gu, luts.gv));
+        dst[4 * x + 2] = to_channel(luma, chroma_term(du, dv, 0, luts.rv));
+        dst[4 * x + 3] = 255;
+    }
+}
+
+#if defined(RAHA_COLOR_SSE2)
+// Coefficients for madd over interleaved (u - 128, v - 128) pairs.
+__m128i coefficient_pair(int16_t cu, int16_t cv) {
+    return _mm_set1_epi32(static_cast<int>(static_cast<uint16_t>(cu) | (static_cast<uint32_t>(static_cast<uint16_t>(cv)) << 16)));
+}
+
+__m128i load4(const uint8_t* src) {
+    int32_t value = 0;
+    std::memcpy(&value, src, sizeof(value));
+    return _mm_cvtsi32_si128(value);
+}
+
+void convert_row_sse2(const ColorLuts& luts, const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width) {
+    const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i rounding = _mm_set1_epi32(1 << (chroma_shift - 1));
+    const __m128i red_coefficients = coefficient_pair(0, luts.rv);
+    const __m128i green_coefficients = coefficient_pair(luts.gu, luts.gv);
+    const __m128i blue_coefficients = coefficient_pair(luts.bu, 0);
+    const int32_t* table = luts.y.data();
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        // SSE2 has no gather, so the eight luma lookups are scalar loads into one register.
+        const __m128i luma = _mm_setr_epi16(static_cast<int16_t>(table[y[x]]), static_cast<int16_t>(table[y[x + 1]]),
+            static_cast<int16_t>(table[y[x + 2]]), static_cast<int16_t>(table[y[x + 3]]), static_cast<int16_t>(table[y[x + 4]]),
+            static_cast<int16_t>(table[y[x + 5]]), static_cast<int16_t>(table[y[x + 6]]), static_cast<int16_t>(table[y[x + 7]]));
+        const int c = x >> 1;
+        const __m128i uv = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(load4(u + c), load4(v + c)), zero), bias);
+        auto term = [&](__m128i coefficients) {
+            __m128i t = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(uv, coefficients), rounding), chroma_shift);
+            t = _mm_packs_epi32(t, t);
+            // Each chroma sample covers two pixels.
+            return _mm_unpacklo_epi16(t, t);
+        };
+
+        __m128i red = _mm_srai_epi16(_mm_adds_epi16(luma, term(red_coefficients)), fraction_bits);
+        __m128i green = _mm_srai_epi16(_mm_adds_epi16(luma, term(green_coefficients)), fraction_bits);
+        __m128i blue = _mm_srai_epi16(_mm_adds_epi16(luma, term(blue_coefficients)), fraction_bits);
+        red = _mm_packus_epi16(red, red);
+        green = _mm_packus_epi16(green, green);
+        blue = _mm_packus_epi16(blue, blue);
+
+        const __m128i bg = _mm_unpacklo_epi8(blue, green);
+        const __m128i ra = _mm_unpacklo_epi8(red, alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x + 16), _mm_unpackhi_epi16(bg, ra));
+    }
+    if (x < width) {
+        convert_row_scalar(luts, y + x, u + (x >> 1), v + (x >> 1), dst + 4 * x, width - x);
+    }
+}
+#endif
+
+bool cpu_has_avx2() {
+#if defined(RAHA_HAS_AVX2_KERNEL)
+#if defined(_MSC_VER)
+    int info[4] {};
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+#else
+    return false;
+#endif
+}
+
+struct MatrixCoefficients {
+    double kr;
+    double kb;
+};
+
+MatrixCoefficients matrix_for(AVColorSpace colorspace) {
+    switch (colorspace) {
+    case AVCOL_SPC_BT709:
+        return {0.2126, 0.0722};
+    case AVCOL_SPC_FCC:
+        return {0.30, 0.11};
+    case AVCOL_SPC_SMPTE240M:
+        return {0.212, 0.087};
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL: // constant luminance is approximated by its matrix
+        return {0.2627, 0.0593};
+    default:
+        return {0.299, 0.114};
+    }
+}
+
+bool same_adjustments(const VideoAdjustments& a, const VideoAdjustments& b) {
+    return a.brightness == b.brightness && a.contrast == b.contrast && a.saturation == b.saturation && a.gamma == b.gamma;
+}
+
+} // namespace
+
+bool adjustments_active(const VideoAdjustments& adjustments) {
+    return adjustments.brightness != 0.0F || adjustments.contrast != 0.0F || adjustments.saturation != 0.0F || adjustments.gamma != 0.0F;
+}
+
+AVColorSpace resolve_colorspace(AVColorSpace tagged, int source_height) {
+    switch (tagged) {
+    case AVCOL_SPC_BT709:
+    case AVCOL_SPC_FCC:
+    case AVCOL_SPC_BT470BG:
+    case AVCOL_SPC_SMPTE170M:
+    case AVCOL_SPC_SMPTE240M:
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        return tagged;
+    default:
+        return source_height >= 720 ? AVCOL_SPC_BT709 : AVCOL_SPC_SMPTE170M;
+    }
+}
+
+bool full_range(const AVFrame* frame) {
+    switch (static_cast<AVPixelFormat>(frame->format)) {
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUVJ444P:
+    case AV_PIX_FMT_YUVJ440P:
+    case AV_PIX_FMT_YUVJ411P:
+        return true;
+    default:
+        return frame->color_range == AVCOL_RANGE_JPEG;
+    }
+}
+
+ColorLuts build_color_luts(const VideoAdjustments& adjustments, AVColorSpace colorspace, AVColorRange range) {
+    const bool full_range = range == AVCOL_RANGE_JPEG;
+    const double luma_offset = full_range ? 0.0 : 16.0;
+    const double luma_scale = full_range ? 1.0 / 255.0 : 1.0 / 219.0;
+    const double chroma_scale = full_range ? 1.0 : 255.0 / 224.0;
+    const double contrast = std::max(0.0, 1.0 + static_cast<double>(adjustments.contrast));
+    const double saturation = std::max(0.0, 1.0 + static_cast<double>(adjustments.saturation));
+    const double exponent = std::pow(2.0, -static_cast<double>(adjustments.gamma));
+
+    const MatrixCoefficients m = matrix_for(colorspace);
+    const double kg = 1.0 - m.kr - m.kb;
+    const double rv = 2.0 * (1.0 - m.kr);
+    const double bu = 2.0 * (1.0 - m.kb);
+    const double gu = -bu * m.kb / kg;
+    const double gv = -rv * m.kr / kg;
+
+    ColorLuts luts;
+    for (int i = 0; i < 256; ++i) {
+        double v = std::clamp((i - luma_offset) * luma_scale, 0.0, 1.0);
+        v = (v - 0.5) * contrast + 0.5 + static_cast<double>(adjustments.brightness);
+        v = std::pow(std::clamp(v, 0.0, 1.0), exponent);
+        // The half step makes the kernels' truncating shift round to nearest.
+        luts.y[static_cast<std::size_t>(i)] = to_fixed(v * 255.0 + 0.5);
+    }
+    const double chroma = chroma_scale * saturation;
+    luts.rv = to_fixed(chroma * rv, coefficient_bits);
+    luts.gu = to_fixed(chroma * gu, coefficient_bits);
+    luts.gv = to_fixed(chroma * gv, coefficient_bits);
+    luts.bu = to_fixed(chroma * bu, coefficient_bits);
+    return luts;
+}
+
+ColorKernel detect_color_kernel() {
+    if (cpu_has_avx2()) {
+        return ColorKernel::Avx2;
+    }
+#if defined(RAHA_COLOR_SSE2)
+    return ColorKernel::Sse2;
+#else
+    return ColorKernel::Scalar;
+#endif
+}
+
+ColorRowFunction color_row_function(ColorKernel kernel) {
+    switch (kernel) {
+    case ColorKernel::Scalar:
+        return &convert_row_scalar;
+    case ColorKernel::Sse2:
+#if defined(RAHA_COLOR_SSE2)
+        return &convert_row_sse2;
+#else
+        return nullptr;
+#endif
+    case ColorKernel::Avx2:
+#if defined(RAHA_HAS_AVX2_KERNEL)
+        return cpu_has_avx2() ? &convert_row_avx2 : nullptr;
+#else
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+const char* to_string(ColorKernel kernel) {
+    switch (kernel) {
+    case ColorKernel::Scalar:
+        return "scalar";
+    case ColorKernel::Sse2:
+        return "sse2";
+    case ColorKernel::Avx2:
+        return "avx2";
+    }
+    return "scalar";
+}
+
+ColorConverter::ColorConverter() {
+    set_kernel(detect_color_kernel());
+}
+
+bool ColorConverter::set_kernel(ColorKernel kernel) {
+    ColorRowFunction row = color_row_function(kernel);
+    if (!row) {
+        return false;
+    }
+    kernel_ = kernel;
+    row_ = row;
+    return true;
+}
+
+void ColorConverter::configure(const VideoAdjustments& adjustments, AVColorSpace colorspace, AVColorRange range) {
+    if (configured_ && same_adjustments(adjustments, adjustments_) && colorspace == colorspace_ && range == range_) {
+        return;
+    }
+    luts_ = build_color_luts(adjustments, colorspace, range);
+    adjustments_ = adjustments;
+    colorspace_ = colorspace;
+    range_ = range;
+    configured_ = true;
+}
+
+bool ColorConverter::supports(AVPixelFormat format) {
+    return format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUVJ420P || format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_NV21;
+}
+
+bool ColorConverter::convert(const AVFrame* src, uint8_t* dst, int dst_pitch) {
+    const auto format = static_cast<AVPixelFormat>(src->format);
+    if (!supports(format) || !configured_) {
+        return false;
+    }
+    const int width = src->width;
+    const int chroma_width = (width + 1) / 2;
+    const bool semi_planar = format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_NV21;
+    const int u_offset = format == AV_PIX_FMT_NV21 ? 1 : 0;
+    if (semi_planar) {
+        u_row_.resize(static_cast<std::size_t>(chroma_width));
+        v_row_.resize(static_cast<std::size_t>(chroma_width));
+    }
+    int chroma_row = -1;
+    const uint8_t* u = nullptr;
+    const uint8_t* v = nullptr;
+    for (int row = 0; row < src->height; ++row) {
+        if ((row >> 1) != chroma_row) {
+            chroma_row = row >> 1;
+            if (semi_planar) {
+                const uint8_t* uv = src->data[1] + static_cast<std::ptrdiff_t>(chroma_row) * src->linesize[1];
+                for (int c = 0; c < chroma_width; ++c) {
+                    u_row_[static_cast<std::size_t>(c)] = uv[2 * c + u_offset];
+                    v_row_[static_cast<std::size_t>(c)] = uv[2 * c + 1 - u_offset];
+                }
+                u = u_row_.data();
+                v = v_row_.data();
+            } else {
+                u = src->data[1] + static_cast<std::ptrdiff_t>(chroma_row) * src->linesize[1];
+                v = src->data[2] + static_cast<std::ptrdiff_t>(chroma_row) * src->linesize[2];
+            }
+        }
+        const uint8_t* luma = src->data[0] + static_cast<std::ptrdiff_t>(row) * src->linesize[0];
+        row_(luts_, luma, u, v, dst + static_cast<std::ptrdiff_t>(row) * dst_pitch, width);
+    }
+    return true;
+}
+
+} // namespace raha::core
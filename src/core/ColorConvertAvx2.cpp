@@ -0,0 +1,87 @@
+#include "raha/core/ColorConvert.hpp"
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+namespace raha::core {
+
+namespace {
+constexpr int fraction_bits = 6;
+constexpr int chroma_shift = 12 - fraction_bits;
+
+int16_t saturate16(int value) {
+    return static_cast<int16_t>(std::clamp(value, -32768, 32767));
+}
+
+int16_t chroma_term(int du, int dv, int16_t cu, int16_t cv) {
+    return saturate16((du * cu + dv * cv + (1 << (chroma_shift - 1))) >> chroma_shift);
+}
+
+uint8_t to_channel(int16_t luma, int16_t chroma) {
+    return static_cast<uint8_t>(std::clamp(saturate16(luma + chroma) >> fraction_bits, 0, 255));
+}
+
+__m256i coefficient_pair(int16_t cu, int16_t cv) {
+    return _mm256_set1_epi32(static_cast<int>(static_cast<uint16_t>(cu) | (static_cast<uint32_t>(static_cast<uint16_t>(cv)) << 16)));
+}
+
+} // namespace
+
+void convert_row_avx2(const ColorLuts& luts, const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int width) {
+    const __m256i alpha = _mm256_set1_epi8(static_cast<char>(0xFF));
+    const __m256i bias = _mm256_set1_epi16(128);
+    const __m256i rounding = _mm256_set1_epi32(1 << (chroma_shift - 1));
+    const __m256i red_coefficients = coefficient_pair(0, luts.rv);
+    const __m256i green_coefficients = coefficient_pair(luts.gu, luts.gv);
+    const __m256i blue_coefficients = coefficient_pair(luts.bu, 0);
+    const int* table = reinterpret_cast<const int*>(luts.y.data());
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        // Two gathers of eight luma entries; packing interleaves them per lane, the
+        // permute puts pixels 0-7 and 8-15 back in their own lanes.
+        const __m128i luma_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+        const __m256i luma_low = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(luma_bytes), 4);
+        const __m256i luma_high = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(luma_bytes, 8)), 4);
+        const __m256i luma = _mm256_permute4x64_epi64(_mm256_packs_epi32(luma_low, luma_high), 0xD8);
+
+        // Eight interleaved (u - 128, v - 128) pairs; madd yields one term per chroma
+        // sample, lane 0 for pixels 0-7 and lane 1 for 8-15.
+        const int c = x >> 1;
+        const __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + c));
+        const __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + c));
+        const __m256i uv = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, v8)), bias);
+        auto term = [&](__m256i coefficients) {
+            __m256i t = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(uv, coefficients), rounding), chroma_shift);
+            t = _mm256_packs_epi32(t, t);
+            return _mm256_unpacklo_epi16(t, t);
+        };
+
+        __m256i red = _mm256_srai_epi16(_mm256_adds_epi16(luma, term(red_coefficients)), fraction_bits);
+        __m256i green = _mm256_srai_epi16(_mm256_adds_epi16(luma, term(green_coefficients)), fraction_bits);
+        __m256i blue = _mm256_srai_epi16(_mm256_adds_epi16(luma, term(blue_coefficients)), fraction_bits);
+        // Packing works per 128-bit lane: lane 0 holds pixels 0-7, lane 1 pixels 8-15.
+        red = _mm256_packus_epi16(red, red);
+        green = _mm256_packus_epi16(green, green);
+        blue = _mm256_packus_epi16(blue, blue);
+
+        const __m256i bg = _mm256_unpacklo_epi8(blue, green);
+        const __m256i ra = _mm256_unpacklo_epi8(red, alpha);
+        const __m256i low = _mm256_unpacklo_epi16(bg, ra);  // pixels 0-3 | 8-11
+        const __m256i high = _mm256_unpackhi_epi16(bg, ra); // pixels 4-7 | 12-15
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * x), _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * x + 32), _mm256_permute2x128_si256(low, high, 0x31));
+    }
+    for (; x < width; ++x) {
+        const int c = x >> 1;
+        const int du = u[c] - 128;
+        const int dv = v[c] - 128;
+        const auto luma = static_cast<int16_t>(luts.y[y[x]]);
+        dst[4 * x + 0] = to_channel(luma, chroma_term(du, dv, luts.bu, 0));
+        dst[4 * x + 1] = to_channel(luma, chroma_term(du, dv, luts.gu, luts.gv));
+        dst[4 * x + 2] = to_channel(luma, chroma_term(du, dv, 0, luts.rv));
+        dst[4 * x + 3] = 255;
+    }
+}
+
+} // namespace raha::core
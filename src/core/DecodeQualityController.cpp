@@ -0,0 +1,96 @@
+#include "raha/core/DecodeQualityController.hpp"
+
+namespace raha::core {
+
+const char* to_string(DecodeQuality quality) {
+    switch (quality) {
+    case DecodeQuality::Full:
+        return "full";
+    case DecodeQuality::SkipLoopFilter:
+        return "skip-loop-filter";
+    case DecodeQuality::SkipNonRef:
+        return "skip-nonref";
+    case DecodeQuality::LowRes:
+        return "lowres";
+    case DecodeQuality::KeyframeOnly:
+        return "keyframe-only";
+    }
+    return "full";
+}
+
+DecodeDiscardSettings discard_settings(DecodeQuality quality) {
+    DecodeDiscardSettings settings;
+    if (quality >= DecodeQuality::SkipLoopFilter) {
+        settings.skip_loop_filter = AVDISCARD_ALL;
+    }
+    if (quality >= DecodeQuality::SkipNonRef) {
+        settings.skip_frame = AVDISCARD_NONREF;
+        settings.skip_idct = AVDISCARD_NONREF;
+    }
+    if (quality >= DecodeQuality::LowRes) {
+        settings.lowres = true;
+    }
+    if (quality >= DecodeQuality::KeyframeOnly) {
+        settings.skip_frame = AVDISCARD_NONKEY;
+    }
+    return settings;
+}
+
+DecodeQualityController::DecodeQualityController(DecodeQualityTuning tuning) : tuning_(tuning) {}
+
+void DecodeQualityController::reset(double frame_interval, bool lowres_supported) {
+    frame_interval_ = frame_interval;
+    lowres_supported_ = lowres_supported;
+    level_ = DecodeQuality::Full;
+    average_ = 0.0;
+    has_average_ = false;
+    since_change_ = 0;
+    over_ = 0;
+    under_ = 0;
+}
+
+std::optional<DecodeQuality> DecodeQualityController::record(double decode_seconds) {
+    average_ = has_average_ ? average_ + tuning_.average_weight * (decode_seconds - average_) : decode_seconds;
+    has_average_ = true;
+    if (frame_interval_ <= 0.0 || ++since_change_ < tuning_.settle_samples) {
+        return std::nullopt;
+    }
+
+    if (average_ > frame_interval_ * tuning_.degrade_ratio) {
+        ++over_;
+        under_ = 0;
+    } else if (average_ < frame_interval_ * tuning_.recover_ratio) {
+        ++under_;
+        over_ = 0;
+    } else {
+        over_ = 0;
+        under_ = 0;
+    }
+
+    if (over_ >= tuning_.degrade_samples && level_ != DecodeQuality::KeyframeOnly) {
+        change(step(1));
+        return level_;
+    }
+    if (under_ >= tuning_.recover_samples && level_ != DecodeQuality::Full) {
+        change(step(-1));
+        return level_;
+    }
+    return std::nullopt;
+}
+
+DecodeQuality DecodeQualityController::step(int direction) const {
+    auto next = static_cast<DecodeQuality>(static_cast<int>(level_) + direction);
+    if (next == DecodeQuality::LowRes && !lowres_supported_) {
+        next = static_cast<DecodeQuality>(static_cast<int>(next) + direction);
+    }
+    return next;
+}
+
+void DecodeQualityController::change(DecodeQuality level) {
+    level_ = level;
+    since_change_ = 0;
+    over_ = 0;
+    under_ = 0;
+}
+
+} // namespace raha::core
@@ -7,177 +7,442 @@ extern "C" {
 #include <libavutil/imgutils.h>
 }
 
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
+#include <utility>
 
 namespace raha::core {
 
 namespace {
-FramePtr make_frame() {
-    AVFrame* frame = av_frame_alloc();
-    if (!frame) {
-        throw std::runtime_error("Failed to allocate AVFrame");
+constexpr PacketQueueLimits video_packet_limits {32 * 1024 * 1024, 3.0, 25};
+constexpr PacketQueueLimits audio_packet_limits {2 * 1024 * 1024, 3.0, 25};
+constexpr std::size_t video_frame_capacity = 8;
+constexpr std::size_t audio_frame_capacity = 32;
+constexpr std::size_t demux_hard_byte_limit = video_packet_limits.max_bytes + audio_packet_limits.max_bytes;
+
+void apply_threading_policy(AVCodecContext* ctx, const AVCodec* codec, const DecoderSettings& settings) {
+    DecoderThreadingPolicy policy = settings.threading;
+    if (auto it = settings.codec_threading.find(codec->name); it != settings.codec_threading.end()) {
+        policy = it->second;
     }
-    return FramePtr(frame);
+    switch (policy.thread_type) {
+    case DecoderThreadType::Frame:
+        ctx->thread_type = FF_THREAD_FRAME;
+        break;
+    case DecoderThreadType::Slice:
+        ctx->thread_type = FF_THREAD_SLICE;
+        break;
+    case DecoderThreadType::Auto:
+        ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        break;
+    }
+    ctx->thread_count = std::max(policy.thread_count, 0);
 }
 
-void drain_frames(AVCodecContext* ctx, std::queue<FramePtr>& fifo) {
-    auto logger = utils::get_logger();
-    while (true) {
-        FramePtr frame = make_frame();
-        int ret = avcodec_receive_frame(ctx, frame.get());
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            return;
-        }
-        if (ret < 0) {
-            logger->error("Error receiving frame: {}", ret);
-            return;
-        }
-        fifo.push(std::move(frame));
+DecoderThreadingInfo threading_info(const AVCodecContext* ctx) {
+    DecoderThreadingInfo info;
+    if (!ctx) {
+        return info;
+    }
+    info.codec_name = ctx->codec && ctx->codec->name ? ctx->codec->name : "";
+    info.frame_threading = (ctx->active_thread_type & FF_THREAD_FRAME) != 0;
+    info.slice_threading = (ctx->active_thread_type & FF_THREAD_SLICE) != 0;
+    info.thread_count = (info.frame_threading || info.slice_threading) ? ctx->thread_count : 1;
+    return info;
+}
+
+int64_t frame_end(const AVFrame* frame, int64_t pts, AVRational time_base, int64_t fallback_duration) {
+    int64_t duration = frame->duration;
+    if (duration <= 0 && frame->nb_samples > 0 && frame->sample_rate > 0) {
+        duration = av_rescale_q(frame->nb_samples, AVRational {1, frame->sample_rate}, time_base);
     }
+    return pts + (duration > 0 ? duration : fallback_duration);
 }
 
 } // namespace
 
-DecoderBridge::DecoderBridge() = default;
+DecoderBridge::DecoderBridge()
+    : video_(video_packet_limits, video_frame_capacity), audio_(audio_packet_limits, audio_frame_capacity) {}
 DecoderBridge::~DecoderBridge() { shutdown(); }
 
-bool DecoderBridge::prepare(MediaSource& source) {
+bool DecoderBridge::prepare(MediaSource& source, const DecoderSettings& settings) {
     shutdown();
     source_ = &source;
-    video_ctx_ = create_context(source, AVMEDIA_TYPE_VIDEO, source.video_stream_index());
-    audio_ctx_ = create_context(source, AVMEDIA_TYPE_AUDIO, source.audio_stream_index());
-    packet_.reset(av_packet_alloc());
-    if (!packet_) {
-        throw std::runtime_error("Failed to allocate AVPacket");
-    }
-    if (source.video_stream_index()) {
-        video_stream_index_ = *source.video_stream_index();
+    frame_pool_.set_huge_pages(settings.huge_page_buffers);
+    settings_ = settings;
+    auto logger = utils::get_logger();
+    for (auto [stream, index] : {std::pair {&video_, source.video_stream_index()}, std::pair {&audio_, source.audio_stream_index()}}) {
+        if (!index) {
+            continue;
+        }
+        const AVStream* av_stream = source.raw()->streams[*index];
+        stream->params.reset(avcodec_parameters_alloc());
+        if (!stream->params || avcodec_parameters_copy(stream->params.get(), av_stream->codecpar) < 0) {
+            throw std::runtime_error("Failed to copy codec parameters");
+        }
+        stream->stream_index = *index;
+        stream->time_base = av_stream->time_base;
+        stream->packets.set_time_base(av_stream->time_base);
+        stream->set_context(create_context(stream->params.get(), stream->time_base, settings));
+        stream->active = true;
+        stream->threading = threading_info(stream->ctx.get());
+        logger->info("Decoder {}: {} thread(s){}{}", stream->threading.codec_name, stream->threading.thread_count,
+            stream->threading.frame_threading ? " [frame]" : "",
+            stream->threading.slice_threading ? " [slice]" : "");
     }
-    if (source.audio_stream_index()) {
-        audio_stream_index_ = *source.audio_stream_index();
+    if (video_.active) {
+        const AVStream* stream = source.raw()->streams[video_.stream_index];
+        if (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0) {
+            video_.frame_duration = av_rescale_q(1, av_inv_q(stream->avg_frame_rate), stream->time_base);
+        }
     }
-    eof_ = false;
+    start_decoders();
+    start_demuxer();
     return true;
 }
 
 void DecoderBridge::shutdown() {
-    video_ctx_.reset();
-    audio_ctx_.reset();
-    packet_.reset();
+    stop_demuxer();
+    stop_decoders();
+    if (source_) {
+        auto stats = frame_pool_.stats();
+        utils::get_logger()->debug("Frame pool: frames {}/{} packets {}/{} buffers {}/{} (hits/misses)",
+            stats.frame_hits, stats.frame_misses, stats.packet_hits, stats.packet_misses,
+            stats.buffer_hits, stats.buffer_misses);
+    }
+    for (StreamDecoder* stream : {&video_, &audio_}) {
+        stream->packets.flush();
+        stream->frames.clear();
+        stream->set_context(nullptr);
+        stream->params.reset();
+        stream->active = false;
+        stream->threading = {};
+        stream->stream_index = -1;
+        stream->time_base = AVRational {1, AV_TIME_BASE};
+        stream->frame_duration = 0;
+        stream->catch_up_pts = AV_NOPTS_VALUE;
+    }
     source_ = nullptr;
-    video_stream_index_ = -1;
-    audio_stream_index_ = -1;
-    eof_ = false;
-    video_frames_ = {};
-    audio_frames_ = {};
 }
 
 std::optional<FramePtr> DecoderBridge::next_video_frame() {
-    if (!video_ctx_) {
+    FramePtr frame = video_.frames.try_pop();
+    if (!frame) {
         return std::nullopt;
     }
-    while (video_frames_.empty()) {
-        if (!source_) {
-            return std::nullopt;
+    return frame;
+}
+
+std::optional<FramePtr> DecoderBridge::next_audio_frame() {
+    FramePtr frame = audio_.frames.try_pop();
+    if (!frame) {
+        return std::nullopt;
+    }
+    return frame;
+}
+
+bool DecoderBridge::seek(double seconds, std::optional<int64_t> byte_position, bool exact) {
+    if (!source_) {
+        return false;
+    }
+    stop_demuxer();
+    AVFormatContext* format = source_->raw();
+    int64_t timestamp = static_cast<int64_t>(seconds * AV_TIME_BASE);
+    source_->set_access_pattern(AccessPattern::Random);
+    bool ok = false;
+    if (byte_position && !(format->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+        ok = av_seek_frame(format, -1, *byte_position, AVSEEK_FLAG_BYTE) >= 0;
+        if (!ok) {
+            utils::get_logger()->debug("Byte seek to {} failed, using timestamp seek", *byte_position);
         }
-        if (eof_) {
-            drain_frames(video_ctx_.get(), video_frames_);
-            if (video_frames_.empty()) {
-                return std::nullopt;
-            }
-            break;
+    }
+    if (!ok) {
+        ok = av_seek_frame(format, -1, timestamp, AVSEEK_FLAG_BACKWARD) >= 0;
+    }
+    source_->set_access_pattern(AccessPattern::Sequential);
+    if (ok) {
+        // The workers flush their codecs when they see the first packet of the new serial;
+        // anything they decode from older packets is dropped by the frame queue.
+        for (StreamDecoder* stream : {&video_, &audio_}) {
+            stream->catch_up_pts = exact ? av_rescale_q(timestamp, AV_TIME_BASE_Q, stream->time_base) : AV_NOPTS_VALUE;
+            stream->packets.flush();
+            stream->frames.flush(stream->packets.serial());
         }
-        int ret = av_read_frame(source_->raw(), packet_.get());
-        if (ret < 0) {
-            eof_ = true;
-            avcodec_send_packet(video_ctx_.get(), nullptr);
-            if (audio_ctx_) {
-                avcodec_send_packet(audio_ctx_.get(), nullptr);
-            }
-            av_packet_unref(packet_.get());
+    }
+    start_demuxer();
+    return ok;
+}
+
+void DecoderBridge::start_decoders() {
+    decode_stop_ = false;
+    for (StreamDecoder* stream : {&video_, &audio_}) {
+        if (!stream->active || stream->worker.joinable()) {
             continue;
         }
-        if (packet_->stream_index == video_stream_index_) {
-            avcodec_send_packet(video_ctx_.get(), packet_.get());
-            drain_frames(video_ctx_.get(), video_frames_);
-        } else if (audio_ctx_ && packet_->stream_index == audio_stream_index_) {
-            avcodec_send_packet(audio_ctx_.get(), packet_.get());
-            drain_frames(audio_ctx_.get(), audio_frames_);
-        }
-        av_packet_unref(packet_.get());
+        stream->packets.start();
+        stream->frames.start();
+        stream->frames.flush(stream->packets.serial());
+        stream->worker = std::thread([this, stream] { decode_loop(*stream); });
     }
+}
 
-    FramePtr frame = std::move(video_frames_.front());
-    video_frames_.pop();
-    return frame;
+void DecoderBridge::stop_decoders() {
+    decode_stop_ = true;
+    for (StreamDecoder* stream : {&video_, &audio_}) {
+        stream->packets.abort();
+        stream->frames.stop();
+        if (stream->worker.joinable()) {
+            stream->worker.join();
+        }
+    }
 }
 
-std::optional<FramePtr> DecoderBridge::next_audio_frame() {
-    if (!audio_ctx_) {
-        return std::nullopt;
+void DecoderBridge::decode_loop(StreamDecoder& stream) {
+    using clock = std::chrono::steady_clock;
+    auto logger = utils::get_logger();
+    // Only this worker replaces stream.ctx, so it may use the raw pointer unlocked.
+    AVCodecContext* ctx = stream.context().get();
+    FramePtr frame = frame_pool_.acquire_frame();
+    int serial = stream.packets.serial();
+
+    const bool adaptive = settings_.adaptive_quality && ctx->codec_type == AVMEDIA_TYPE_VIDEO && stream.frame_duration > 0;
+    const double frame_interval = stream.frame_duration * av_q2d(stream.time_base);
+    DecodeDiscardSettings base {ctx->skip_frame, ctx->skip_idct, ctx->skip_loop_filter, ctx->lowres > 0};
+    if (adaptive) {
+        video_quality_.reset(frame_interval, ctx->codec->max_lowres > 0);
+        video_quality_level_ = DecodeQuality::Full;
     }
-    while (audio_frames_.empty()) {
-        if (!source_) {
-            return std::nullopt;
+    clock::duration busy {};
+    bool wait_for_keyframe = false;
+    bool keyframes_only = false;
+
+    int64_t catch_up_pts = AV_NOPTS_VALUE;
+    auto skip_frame = [&] {
+        return keyframes_only ? std::max(base.skip_frame, AVDISCARD_NONKEY) : base.skip_frame;
+    };
+    auto apply_base = [&] {
+        ctx->skip_frame = skip_frame();
+        ctx->skip_idct = base.skip_idct;
+        ctx->skip_loop_filter = base.skip_loop_filter;
+    };
+    auto end_catch_up = [&] {
+        catch_up_pts = AV_NOPTS_VALUE;
+        apply_base();
+    };
+    // The quality controller asks for one lowres step; the renderer's hint may ask for more.
+    auto wanted_lowres = [&](bool degraded) {
+        int lowres = &stream == &video_ ? lowres_hint_.load() : 0;
+        lowres = std::max(lowres, degraded ? 1 : 0);
+        return std::min(lowres, static_cast<int>(ctx->codec->max_lowres));
+    };
+    // Hands every frame the decoder has ready to the queue; returns the receive result
+    // that ended the loop.
+    auto receive_frames = [&] {
+        int ret = 0;
+        while (true) {
+            auto receive_start = clock::now();
+            ret = avcodec_receive_frame(ctx, frame.get());
+            busy += clock::now() - receive_start;
+            if (ret != 0) {
+                return ret;
+            }
+            if (catch_up_pts != AV_NOPTS_VALUE) {
+                int64_t pts = frame->best_effort_timestamp;
+                if (pts != AV_NOPTS_VALUE && frame_end(frame.get(), pts, stream.time_base, stream.frame_duration) <= catch_up_pts) {
+                    // Frames before the target never reach the queue, so nothing is converted or uploaded for them.
+                    av_frame_unref(frame.get());
+                    continue;
+                }
+                end_catch_up();
+            }
+            stream.frames.push(std::move(frame), serial);
+            frame = frame_pool_.acquire_frame();
+            // Audio frames are pulled by the audio refill thread; waking the main loop for
+            // them would only present the same video frame again.
+            if (&stream == &video_ && frame_callback_) {
+                frame_callback_();
+            }
+        }
+    };
+    // lowres is only honoured by avcodec_open2, so the decoder is reopened; it can only
+    // resume at a keyframe. The old one is drained first, so the frames it still holds
+    // for packets already sent are queued rather than lost.
+    auto reopen = [&](int lowres) {
+        std::shared_ptr<AVCodecContext> next;
+        try {
+            next = create_context(stream.params.get(), stream.time_base, settings_, lowres);
+        } catch (const std::exception& e) {
+            logger->warn("Failed to reopen decoder for lowres {}: {}", lowres, e.what());
+            return false;
         }
-        if (eof_) {
-            drain_frames(audio_ctx_.get(), audio_frames_);
-            if (audio_frames_.empty()) {
-                return std::nullopt;
+        avcodec_send_packet(ctx, nullptr);
+        if (int ret = receive_frames(); ret != AVERROR_EOF) {
+            logger->warn("Error draining decoder before reopen: {}", ret);
+        }
+        ctx = next.get();
+        stream.set_context(std::move(next));
+        return true;
+    };
+    auto change_quality = [&](DecodeQuality level) {
+        DecodeDiscardSettings next = discard_settings(level);
+        logger->info("Decode quality for {}: {} (average {:.1f} ms per frame, interval {:.1f} ms)", stream.threading.codec_name,
+            to_string(level), video_quality_.average() * 1000.0, video_quality_.frame_interval() * 1000.0);
+        if (int lowres = wanted_lowres(next.lowres); lowres != ctx->lowres) {
+            if (reopen(lowres)) {
+                wait_for_keyframe = true;
+            } else {
+                next.lowres = base.lowres;
             }
+        }
+        base = next;
+        apply_base();
+        video_quality_level_ = level;
+    };
+
+    while (!decode_stop_) {
+        int ret = receive_frames();
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            logger->error("Error receiving frame: {}", ret);
+        }
+
+        auto queued = stream.packets.pop(true);
+        if (!queued) {
             break;
         }
-        int ret = av_read_frame(source_->raw(), packet_.get());
-        if (ret < 0) {
-            eof_ = true;
-            if (video_ctx_) {
-                avcodec_send_packet(video_ctx_.get(), nullptr);
+        if (queued->serial != serial) {
+            avcodec_flush_buffers(ctx);
+            serial = queued->serial;
+            end_catch_up();
+            catch_up_pts = stream.catch_up_pts.load();
+        }
+        const AVPacket* packet = queued->packet.get();
+        if (&stream == &video_ && keyframes_only != keyframes_only_.load()) {
+            keyframes_only = !keyframes_only;
+            if (!keyframes_only) {
+                // Upcoming frames reference pictures that were never decoded.
+                avcodec_flush_buffers(ctx);
+                wait_for_keyframe = true;
             }
-            avcodec_send_packet(audio_ctx_.get(), nullptr);
-            av_packet_unref(packet_.get());
+            apply_base();
+        }
+        if (keyframes_only && packet && !(packet->flags & AV_PKT_FLAG_KEY)) {
+            demux_cv_.notify_one();
             continue;
         }
-        if (packet_->stream_index == audio_stream_index_) {
-            avcodec_send_packet(audio_ctx_.get(), packet_.get());
-            drain_frames(audio_ctx_.get(), audio_frames_);
-        } else if (video_ctx_ && packet_->stream_index == video_stream_index_) {
-            avcodec_send_packet(video_ctx_.get(), packet_.get());
-            drain_frames(video_ctx_.get(), video_frames_);
+        if (wait_for_keyframe) {
+            if (packet && !(packet->flags & AV_PKT_FLAG_KEY)) {
+                demux_cv_.notify_one();
+                continue;
+            }
+            wait_for_keyframe = false;
         }
-        av_packet_unref(packet_.get());
-    }
+        if (packet && (packet->flags & AV_PKT_FLAG_KEY)) {
+            // Output-size lowres changes wait for a keyframe, which the new decoder can start
+            // from without skipping any packets.
+            if (int lowres = wanted_lowres(base.lowres); lowres != ctx->lowres && reopen(lowres)) {
+                apply_base();
+            }
+        }
+        if (catch_up_pts != AV_NOPTS_VALUE && ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+            // Only packets known to end before the target may be decoded cheaply; the target
+            // itself can be a non-reference frame.
+            int64_t duration = packet && packet->duration > 0 ? packet->duration : stream.frame_duration;
+            bool before_target = packet && packet->pts != AV_NOPTS_VALUE && duration > 0 && packet->pts + duration <= catch_up_pts;
+            ctx->skip_frame = before_target ? std::max(skip_frame(), AVDISCARD_NONREF) : skip_frame();
+            ctx->skip_loop_filter = before_target && settings_.seek_skip_loop_filter ? AVDISCARD_ALL : base.skip_loop_filter;
+        }
+        auto send_start = clock::now();
+        ret = avcodec_send_packet(ctx, packet);
+        busy += clock::now() - send_start;
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            logger->warn("Error sending packet to decoder: {}", ret);
+        }
+        demux_cv_.notify_one();
 
-    FramePtr frame = std::move(audio_frames_.front());
-    audio_frames_.pop();
-    return frame;
+        // Time spent inside libavcodec per packet, excluding waits on either queue. Catch-up
+        // and keyframe-only decoding are deliberately faster than real time and would skew
+        // the average.
+        if (adaptive && packet && catch_up_pts == AV_NOPTS_VALUE && !keyframes_only) {
+            video_quality_.set_frame_interval(frame_interval / std::max(playback_speed_.load(), 0.01));
+            if (auto level = video_quality_.record(std::chrono::duration<double>(busy).count())) {
+                change_quality(*level);
+            }
+        }
+        busy = {};
+    }
 }
 
-bool DecoderBridge::seek(double seconds) {
-    if (!source_) {
-        return false;
+void DecoderBridge::start_demuxer() {
+    if (!source_ || demux_thread_.joinable()) {
+        return;
     }
-    int64_t timestamp = static_cast<int64_t>(seconds * AV_TIME_BASE);
-    if (av_seek_frame(source_->raw(), -1, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
-        return false;
+    demux_stop_ = false;
+    demux_thread_ = std::thread([this] { demux_loop(); });
+}
+
+void DecoderBridge::stop_demuxer() {
+    if (!demux_thread_.joinable()) {
+        return;
     }
-    if (video_ctx_) {
-        avcodec_flush_buffers(video_ctx_.get());
+    {
+        std::scoped_lock lock(demux_mutex_);
+        demux_stop_ = true;
     }
-    if (audio_ctx_) {
-        avcodec_flush_buffers(audio_ctx_.get());
+    demux_cv_.notify_all();
+    demux_thread_.join();
+}
+
+bool DecoderBridge::demux_queues_full() const {
+    if (video_.packets.bytes() + audio_.packets.bytes() >= demux_hard_byte_limit) {
+        return true;
     }
-    video_frames_ = {};
-    audio_frames_ = {};
-    eof_ = false;
-    return true;
+    bool video_full = !video_.active || video_.packets.has_enough();
+    bool audio_full = !audio_.active || audio_.packets.has_enough();
+    return video_full && audio_full;
 }
 
-CodecContextPtr DecoderBridge::create_context(MediaSource& source, AVMediaType type, std::optional<int> index) {
-    if (!index) {
-        return nullptr;
+void DecoderBridge::demux_loop() {
+    using namespace std::chrono_literals;
+    auto logger = utils::get_logger();
+    while (!demux_stop_) {
+        {
+            std::unique_lock lock(demux_mutex_);
+            if (!demux_cv_.wait_for(lock, 10ms, [this] { return demux_stop_ || !demux_queues_full(); })) {
+                continue;
+            }
+            if (demux_stop_) {
+                break;
+            }
+        }
+
+        PacketPtr packet = frame_pool_.acquire_packet();
+        int ret = av_read_frame(source_->raw(), packet.get());
+        if (ret == AVERROR(EAGAIN)) {
+            continue;
+        }
+        if (ret < 0) {
+            if (ret != AVERROR_EOF) {
+                logger->warn("Demuxer stopped reading: {}", ret);
+            }
+            if (video_.active) {
+                video_.packets.push(nullptr);
+            }
+            if (audio_.active) {
+                audio_.packets.push(nullptr);
+            }
+            break;
+        }
+        if (video_.active && packet->stream_index == video_.stream_index) {
+            video_.packets.push(std::move(packet));
+        } else if (audio_.active && packet->stream_index == audio_.stream_index) {
+            audio_.packets.push(std::move(packet));
+        }
     }
-    AVStream* stream = source.raw()->streams[*index];
-    const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+}
+
+CodecContextPtr DecoderBridge::create_context(const AVCodecParameters* params, AVRational time_base, const DecoderSettings& settings, int lowres) {
+    const AVCodec* codec = avcodec_find_decoder(params->codec_id);
     if (!codec) {
         throw std::runtime_error("Unsupported codec");
     }
@@ -185,10 +450,13 @@ CodecContextPtr DecoderBridge::create_context(MediaSource& source, AVMediaType t
     if (!ctx) {
         throw std::runtime_error("Failed to allocate codec context");
     }
-    if (avcodec_parameters_to_context(ctx.get(), stream->codecpar) < 0) {
+    if (avcodec_parameters_to_context(ctx.get(), params) < 0) {
         throw std::runtime_error("Failed to populate codec context");
     }
-    ctx->pkt_timebase = stream->time_base;
+    ctx->pkt_timebase = time_base;
+    ctx->lowres = lowres;
+    apply_threading_policy(ctx.get(), codec, settings);
+    frame_pool_.attach(ctx.get());
     if (avcodec_open2(ctx.get(), codec, nullptr) < 0) {
         throw std::runtime_error("Failed to open codec context");
     }
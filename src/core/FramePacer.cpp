@@ -0,0 +1,108 @@
+#include "raha/core/FramePacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace raha::core {
+
+namespace {
+constexpr double period_weight = 0.02;
+constexpr double phase_weight = 0.1;
+// Intervals further than this from a whole number of periods are not vsync-locked.
+constexpr double period_tolerance = 0.05;
+constexpr double max_period_drift = 0.1;
+constexpr double max_missed_vsyncs = 8.0;
+constexpr std::size_t duration_window = 240;
+
+} // namespace
+
+void FramePacer::reset(double nominal_interval) {
+    nominal_ = nominal_interval > 0.0 ? nominal_interval : 1.0 / 60.0;
+    period_ = nominal_;
+    has_vsync_ = false;
+    has_frame_shown_ = false;
+    frames_ = 0;
+    durations_.clear();
+}
+
+void FramePacer::record_present(double time) {
+    if (has_vsync_) {
+        const double elapsed = time - last_vsync_;
+        const double count = std::round(elapsed / period_);
+        if (count >= 1.0 && count <= max_missed_vsyncs) {
+            const double error = elapsed / count - period_;
+            if (std::abs(error) < period_ * period_tolerance) {
+                period_ = std::clamp(period_ + period_weight * error, nominal_ * (1.0 - max_period_drift), nominal_ * (1.0 + max_period_drift));
+                // Present returns are delayed by scheduling noise, so the phase is smoothed
+                // instead of jumping to every sample.
+                const double predicted = last_vsync_ + count * period_;
+                last_vsync_ = predicted + phase_weight * (time - predicted);
+                return;
+            }
+        }
+    }
+    // First sample, a long stall or presents that do not wait for vsync.
+    last_vsync_ = time;
+    has_vsync_ = true;
+}
+
+void FramePacer::record_frame_shown() {
+    if (!has_vsync_) {
+        return;
+    }
+    if (has_frame_shown_) {
+        durations_.push_back(last_vsync_ - last_frame_shown_);
+        if (durations_.size() > duration_window) {
+            durations_.pop_front();
+        }
+    }
+    last_frame_shown_ = last_vsync_;
+    has_frame_shown_ = true;
+    ++frames_;
+}
+
+double FramePacer::next_vsync(double now) const {
+    if (!has_vsync_) {
+        return now + period_;
+    }
+    const double elapsed = std::max(0.0, now - last_vsync_);
+    return last_vsync_ + (std::floor(elapsed / period_) + 1.0) * period_;
+}
+
+double FramePacer::display_time(double now, double clock_time, double speed) const {
+    return clock_time + (next_vsync(now) - now + period_ / 2.0) * speed;
+}
+
+double FramePacer::clock_correction(double frame_duration, double max_correction) const {
+    if (frame_duration <= 0.0) {
+        return 1.0;
+    }
+    const double vsyncs = std::round(frame_duration / period_);
+    if (vsyncs < 1.0) {
+        return 1.0;
+    }
+    const double factor = frame_duration / (vsyncs * period_);
+    return std::abs(factor - 1.0) <= max_correction ? factor : 1.0;
+}
+
+PacingStats FramePacer::stats() const {
+    PacingStats stats;
+    stats.refresh_interval = period_;
+    stats.frames = frames_;
+    if (durations_.empty()) {
+        return stats;
+    }
+    double sum = 0.0;
+    for (double duration : durations_) {
+        sum += duration;
+    }
+    stats.mean_display = sum / static_cast<double>(durations_.size());
+    double variance = 0.0;
+    for (double duration : durations_) {
+        variance += (duration - stats.mean_display) * (duration - stats.mean_display);
+    }
+    stats.jitter = std::sqrt(variance / static_cast<double>(durations_.size()));
+    return stats;
+}
+
+} // namespace raha::core
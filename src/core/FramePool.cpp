@@ -0,0 +1,311 @@
+#include "raha/core/FramePool.hpp"
+
+#include "raha/utils/Logger.hpp"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/samplefmt.h>
+}
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace raha::core {
+
+namespace {
+constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+std::size_t bucket_size(std::size_t size) {
+    const std::size_t granularity = size >= 1024 * 1024 ? 64 * 1024 : 4096;
+    return (size + granularity - 1) / granularity * granularity;
+}
+
+void* allocate_aligned(std::size_t alignment, std::size_t size) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, alignment);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return nullptr;
+    }
+    return ptr;
+#endif
+}
+
+void free_aligned(void*, uint8_t* data) {
+#if defined(_WIN32)
+    _aligned_free(data);
+#else
+    std::free(data);
+#endif
+}
+
+} // namespace
+
+void FrameDeleter::operator()(AVFrame* frame) const {
+    if (pool) {
+        pool->recycle(frame);
+    } else {
+        av_frame_free(&frame);
+    }
+}
+
+void PacketDeleter::operator()(AVPacket* pkt) const {
+    if (pool) {
+        pool->recycle(pkt);
+    } else {
+        av_packet_free(&pkt);
+    }
+}
+
+FramePool::FramePool(std::size_t max_shells) : max_shells_(max_shells) {
+    frame_shells_.reserve(max_shells_);
+    packet_shells_.reserve(max_shells_);
+}
+
+FramePool::~FramePool() {
+    for (AVFrame* frame : frame_shells_) {
+        av_frame_free(&frame);
+    }
+    for (AVPacket* packet : packet_shells_) {
+        av_packet_free(&packet);
+    }
+    // Buffers still referenced by frames keep their pool alive until they are released.
+    for (auto& [size, bucket] : buckets_) {
+        av_buffer_pool_uninit(&bucket);
+    }
+}
+
+void FramePool::attach(AVCodecContext* ctx) {
+    if (!ctx) {
+        return;
+    }
+    ctx->opaque = this;
+    ctx->get_buffer2 = &FramePool::get_buffer;
+}
+
+FramePtr FramePool::acquire_frame() {
+    AVFrame* frame = nullptr;
+    {
+        std::scoped_lock lock(shell_mutex_);
+        if (!frame_shells_.empty()) {
+            frame = frame_shells_.back();
+            frame_shells_.pop_back();
+        }
+    }
+    if (frame) {
+        ++frame_hits_;
+    } else {
+        ++frame_misses_;
+        frame = av_frame_alloc();
+        if (!frame) {
+            throw std::runtime_error("Failed to allocate AVFrame");
+        }
+    }
+    return FramePtr(frame, FrameDeleter {this});
+}
+
+PacketPtr FramePool::acquire_packet() {
+    AVPacket* packet = nullptr;
+    {
+        std::scoped_lock lock(shell_mutex_);
+        if (!packet_shells_.empty()) {
+            packet = packet_shells_.back();
+            packet_shells_.pop_back();
+        }
+    }
+    if (packet) {
+        ++packet_hits_;
+    } else {
+        ++packet_misses_;
+        packet = av_packet_alloc();
+        if (!packet) {
+            throw std::runtime_error("Failed to allocate AVPacket");
+        }
+    }
+    return PacketPtr(packet, PacketDeleter {this});
+}
+
+void FramePool::recycle(AVFrame* frame) {
+    if (!frame) {
+        return;
+    }
+    av_frame_unref(frame);
+    {
+        std::scoped_lock lock(shell_mutex_);
+        if (frame_shells_.size() < max_shells_) {
+            frame_shells_.push_back(frame);
+            return;
+        }
+    }
+    av_frame_free(&frame);
+}
+
+void FramePool::recycle(AVPacket* packet) {
+    if (!packet) {
+        return;
+    }
+    av_packet_unref(packet);
+    {
+        std::scoped_lock lock(shell_mutex_);
+        if (packet_shells_.size() < max_shells_) {
+            packet_shells_.push_back(packet);
+            return;
+        }
+    }
+    av_packet_free(&packet);
+}
+
+FramePoolStats FramePool::stats() const {
+    FramePoolStats stats;
+    stats.frame_hits = frame_hits_.load();
+    stats.frame_misses = frame_misses_.load();
+    stats.packet_hits = packet_hits_.load();
+    stats.packet_misses = packet_misses_.load();
+    const uint64_t requests = buffer_requests_.load();
+    stats.buffer_misses = buffer_misses_.load();
+    stats.buffer_hits = requests - std::min(stats.buffer_misses, requests);
+    return stats;
+}
+
+int FramePool::get_buffer(AVCodecContext* ctx, AVFrame* frame, int flags) {
+    auto* pool = static_cast<FramePool*>(ctx->opaque);
+    if (!pool || !(ctx->codec->capabilities & AV_CODEC_CAP_DR1)) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+    int ret = AVERROR(EINVAL);
+    if (ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        ret = pool->get_video_buffer(ctx, frame);
+    } else if (ctx->codec_type == AVMEDIA_TYPE_AUDIO) {
+        ret = pool->get_audio_buffer(frame);
+    }
+    if (ret == AVERROR(ENOSYS)) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+    if (ret < 0) {
+        av_frame_unref(frame);
+    }
+    return ret;
+}
+
+AVBufferRef* FramePool::allocate_buffer(void* opaque, std::size_t size) {
+    auto* pool = static_cast<FramePool*>(opaque);
+    ++pool->buffer_misses_;
+    bool huge = pool->huge_pages_ && size >= huge_page_size;
+    void* data = allocate_aligned(huge ? huge_page_size : buffer_alignment, size);
+    if (!data) {
+        return nullptr;
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (huge) {
+        madvise(data, size, MADV_HUGEPAGE);
+    }
+#endif
+    AVBufferRef* ref = av_buffer_create(static_cast<uint8_t*>(data), size, &free_aligned, nullptr, 0);
+    if (!ref) {
+        free_aligned(nullptr, static_cast<uint8_t*>(data));
+    }
+    return ref;
+}
+
+AVBufferRef* FramePool::buffer_for(std::size_t size) {
+    const std::size_t bucket = bucket_size(size);
+    AVBufferPool* pool = nullptr;
+    {
+        std::scoped_lock lock(bucket_mutex_);
+        auto it = buckets_.find(bucket);
+        if (it == buckets_.end()) {
+            pool = av_buffer_pool_init2(bucket, this, &FramePool::allocate_buffer, nullptr);
+            if (!pool) {
+                return nullptr;
+            }
+            buckets_.emplace(bucket, pool);
+        } else {
+            pool = it->second;
+        }
+    }
+    ++buffer_requests_;
+    return av_buffer_pool_get(pool);
+}
+
+int FramePool::get_video_buffer(AVCodecContext* ctx, AVFrame* frame) {
+    auto format = static_cast<AVPixelFormat>(frame->format);
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+        return AVERROR(ENOSYS);
+    }
+
+    int width = frame->width;
+    int height = frame->height;
+    int stride_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(ctx, &width, &height, stride_align);
+
+    // Same search as libavcodec's default allocator: widen until every plane's stride is
+    // aligned, without aligning planes individually (some decoders rely on their ratios).
+    int linesizes[4] {};
+    bool unaligned = false;
+    do {
+        if (av_image_fill_linesizes(linesizes, format, width) < 0) {
+            return AVERROR(EINVAL);
+        }
+        width += width & ~(width - 1);
+        unaligned = false;
+        for (int i = 0; i < 4; ++i) {
+            int align = std::max(stride_align[i], static_cast<int>(buffer_alignment));
+            unaligned |= (linesizes[i] % align) != 0;
+        }
+    } while (unaligned);
+
+    ptrdiff_t plane_linesizes[4];
+    std::size_t plane_sizes[4] {};
+    for (int i = 0; i < 4; ++i) {
+        plane_linesizes[i] = linesizes[i];
+    }
+    if (av_image_fill_plane_sizes(plane_sizes, format, height, plane_linesizes) < 0) {
+        return AVERROR(EINVAL);
+    }
+
+    for (int i = 0; i < 4 && plane_sizes[i] > 0; ++i) {
+        frame->buf[i] = buffer_for(plane_sizes[i] + 16 + buffer_alignment - 1);
+        if (!frame->buf[i]) {
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i] = frame->buf[i]->data;
+        frame->linesize[i] = linesizes[i];
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+int FramePool::get_audio_buffer(AVFrame* frame) {
+    auto format = static_cast<AVSampleFormat>(frame->format);
+    const int channels = frame->ch_layout.nb_channels;
+    const bool planar = av_sample_fmt_is_planar(format) != 0;
+    const int planes = planar ? channels : 1;
+    if (channels <= 0 || planes > AV_NUM_DATA_POINTERS) {
+        return AVERROR(ENOSYS);
+    }
+
+    int linesize = 0;
+    if (av_samples_get_buffer_size(&linesize, channels, frame->nb_samples, format, static_cast<int>(buffer_alignment)) < 0) {
+        return AVERROR(EINVAL);
+    }
+    for (int i = 0; i < planes; ++i) {
+        frame->buf[i] = buffer_for(static_cast<std::size_t>(linesize));
+        if (!frame->buf[i]) {
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i] = frame->buf[i]->data;
+    }
+    frame->linesize[0] = linesize;
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+} // namespace raha::core
@@ -10,10 +10,10 @@ FrameQueue::FrameQueue(std::size_t capacity) : capacity_(capacity) {
     }
 }
 
-void FrameQueue::push(FramePtr frame) {
+void FrameQueue::push(FramePtr frame, int serial) {
     std::unique_lock lock(mutex_);
-    cv_.wait(lock, [this] { return stop_ || queue_.size() < capacity_; });
-    if (stop_) {
+    cv_.wait(lock, [this, serial] { return stop_ || serial != serial_ || queue_.size() < capacity_; });
+    if (stop_ || serial != serial_) {
         return;
     }
     queue_.push(std::move(frame));
@@ -34,20 +34,52 @@ FramePtr FrameQueue::pop() {
     return frame;
 }
 
+FramePtr FrameQueue::try_pop() {
+    std::unique_lock lock(mutex_);
+    if (queue_.empty()) {
+        return {};
+    }
+    auto frame = std::move(queue_.front());
+    queue_.pop();
+    lock.unlock();
+    cv_.notify_all();
+    return frame;
+}
+
 void FrameQueue::clear() {
-    std::scoped_lock lock(mutex_);
-    while (!queue_.empty()) {
-        queue_.pop();
+    {
+        std::scoped_lock lock(mutex_);
+        queue_ = {};
     }
+    cv_.notify_all();
+}
+
+void FrameQueue::flush(int serial) {
+    {
+        std::scoped_lock lock(mutex_);
+        queue_ = {};
+        serial_ = serial;
+    }
+    cv_.notify_all();
 }
 
 void FrameQueue::stop() {
     {
         std::scoped_lock lock(mutex_);
         stop_ = true;
-        clear();
+        queue_ = {};
     }
     cv_.notify_all();
 }
 
+void FrameQueue::start() {
+    std::scoped_lock lock(mutex_);
+    stop_ = false;
+}
+
+std::size_t FrameQueue::size() const {
+    std::scoped_lock lock(mutex_);
+    return queue_.size();
+}
+
 } // namespace raha::core
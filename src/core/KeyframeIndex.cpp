@@ -0,0 +1,166 @@
+#include "raha/core/KeyframeIndex.hpp"
+
+#include "raha/utils/Logger.hpp"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <algorithm>
+
+namespace raha::core {
+
+namespace {
+constexpr uint8_t encoding_version = 1;
+
+void write_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool read_varint(const std::vector<uint8_t>& in, std::size_t& offset, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset >= in.size()) {
+            return false;
+        }
+        uint8_t byte = in[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+struct InputCloser {
+    AVFormatContext* ctx {nullptr};
+    ~InputCloser() {
+        if (ctx) {
+            avformat_close_input(&ctx);
+        }
+    }
+};
+
+int interrupt_requested(void* opaque) {
+    return static_cast<const std::atomic<bool>*>(opaque)->load() ? 1 : 0;
+}
+
+} // namespace
+
+KeyframeIndex::KeyframeIndex(int stream_index, AVRational time_base) : stream_index_(stream_index), time_base_(time_base) {}
+
+std::optional<KeyframeIndex> KeyframeIndex::build(const std::string& path, int stream_index, const std::atomic<bool>& cancel) {
+    InputCloser input;
+    input.ctx = avformat_alloc_context();
+    if (!input.ctx) {
+        return std::nullopt;
+    }
+    input.ctx->interrupt_callback.callback = &interrupt_requested;
+    input.ctx->interrupt_callback.opaque = const_cast<std::atomic<bool>*>(&cancel);
+    if (avformat_open_input(&input.ctx, path.c_str(), nullptr, nullptr) < 0) {
+        input.ctx = nullptr;
+        return std::nullopt;
+    }
+    if (avformat_find_stream_info(input.ctx, nullptr) < 0 || stream_index < 0 || stream_index >= static_cast<int>(input.ctx->nb_streams)) {
+        return std::nullopt;
+    }
+    for (unsigned int i = 0; i < input.ctx->nb_streams; ++i) {
+        input.ctx->streams[i]->discard = static_cast<int>(i) == stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+
+    KeyframeIndex index(stream_index, input.ctx->streams[stream_index]->time_base);
+    AVPacket* packet = av_packet_alloc();
+    if (!packet) {
+        return std::nullopt;
+    }
+    int ret = 0;
+    while (!cancel && (ret = av_read_frame(input.ctx, packet)) >= 0) {
+        if (packet->stream_index == stream_index && (packet->flags & AV_PKT_FLAG_KEY) && packet->pos >= 0) {
+            int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+            if (pts != AV_NOPTS_VALUE) {
+                index.add(pts, packet->pos);
+            }
+        }
+        av_packet_unref(packet);
+    }
+    av_packet_free(&packet);
+    if (cancel || ret != AVERROR_EOF) {
+        return std::nullopt;
+    }
+    index.finish();
+    utils::get_logger()->debug("Indexed {} keyframes in {}", index.size(), path);
+    return index;
+}
+
+std::optional<KeyframeIndex> KeyframeIndex::decode(const std::vector<uint8_t>& data, int stream_index, AVRational time_base) {
+    if (data.empty() || data[0] != encoding_version) {
+        return std::nullopt;
+    }
+    std::size_t offset = 1;
+    uint64_t count = 0;
+    if (!read_varint(data, offset, count) || count > data.size()) {
+        return std::nullopt;
+    }
+    KeyframeIndex index(stream_index, time_base);
+    index.entries_.reserve(static_cast<std::size_t>(count));
+    KeyframeEntry previous;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t pts_delta = 0;
+        uint64_t pos_delta = 0;
+        if (!read_varint(data, offset, pts_delta) || !read_varint(data, offset, pos_delta)) {
+            return std::nullopt;
+        }
+        previous.pts += unzigzag(pts_delta);
+        previous.pos += unzigzag(pos_delta);
+        index.entries_.push_back(previous);
+    }
+    return index;
+}
+
+void KeyframeIndex::add(int64_t pts, int64_t pos) {
+    entries_.push_back({pts, pos});
+}
+
+void KeyframeIndex::finish() {
+    std::stable_sort(entries_.begin(), entries_.end(), [](const KeyframeEntry& a, const KeyframeEntry& b) { return a.pts < b.pts; });
+    entries_.erase(std::unique(entries_.begin(), entries_.end(), [](const KeyframeEntry& a, const KeyframeEntry& b) { return a.pts == b.pts; }), entries_.end());
+}
+
+std::optional<KeyframeEntry> KeyframeIndex::find(int64_t pts) const {
+    if (entries_.empty()) {
+        return std::nullopt;
+    }
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), pts, [](int64_t value, const KeyframeEntry& entry) { return value < entry.pts; });
+    if (it == entries_.begin()) {
+        return entries_.front();
+    }
+    return *std::prev(it);
+}
+
+std::vector<uint8_t> KeyframeIndex::encode() const {
+    std::vector<uint8_t> out;
+    out.reserve(entries_.size() * 4 + 8);
+    out.push_back(encoding_version);
+    write_varint(out, entries_.size());
+    KeyframeEntry previous;
+    for (const KeyframeEntry& entry : entries_) {
+        write_varint(out, zigzag(entry.pts - previous.pts));
+        write_varint(out, zigzag(entry.pos - previous.pos));
+        previous = entry;
+    }
+    return out;
+}
+
+} // namespace raha::core
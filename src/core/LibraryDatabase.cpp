@@ -4,14 +4,30 @@
 
 #include <sqlite3.h>
 
+#include <chrono>
 #include <stdexcept>
 
 namespace raha::core {
 
+std::optional<FileStamp> file_stamp(const std::filesystem::path& path) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    auto modified = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    auto ticks = std::chrono::duration_cast<std::chrono::nanoseconds>(modified.time_since_epoch()).count();
+    return FileStamp {static_cast<uint64_t>(size), static_cast<int64_t>(ticks)};
+}
+
 LibraryDatabase::LibraryDatabase() = default;
 LibraryDatabase::~LibraryDatabase() { close(); }
 
 bool LibraryDatabase::open(const std::filesystem::path& path) {
+    std::scoped_lock lock(mutex_);
     if (sqlite3_open(path.string().c_str(), &db_) != SQLITE_OK) {
         utils::get_logger()->error("Failed to open database: {}", path.string());
         db_ = nullptr;
@@ -22,6 +38,7 @@ bool LibraryDatabase::open(const std::filesystem::path& path) {
 }
 
 void LibraryDatabase::close() {
+    std::scoped_lock lock(mutex_);
     if (db_) {
         sqlite3_close(db_);
         db_ = nullptr;
@@ -41,6 +58,21 @@ void LibraryDatabase::ensure_schema() {
             codec TEXT,
             resolution TEXT
         );
+        CREATE TABLE IF NOT EXISTS probe_cache (
+            path TEXT PRIMARY KEY NOT NULL,
+            file_size INTEGER NOT NULL,
+            modified_time INTEGER NOT NULL,
+            format_name TEXT,
+            streams TEXT NOT NULL,
+            extradata BLOB
+        );
+        CREATE TABLE IF NOT EXISTS keyframe_index (
+            path TEXT PRIMARY KEY NOT NULL,
+            file_size INTEGER NOT NULL,
+            modified_time INTEGER NOT NULL,
+            stream_index INTEGER NOT NULL,
+            entries BLOB NOT NULL
+        );
     )SQL";
     char* err = nullptr;
     if (sqlite3_exec(db_, ddl, nullptr, nullptr, &err) != SQLITE_OK) {
@@ -51,6 +83,7 @@ void LibraryDatabase::ensure_schema() {
 }
 
 void LibraryDatabase::upsert_entry(const MediaEntry& entry) {
+    std::scoped_lock lock(mutex_);
     if (!db_) {
         throw std::runtime_error("Database not opened");
     }
@@ -81,6 +114,7 @@ void LibraryDatabase::upsert_entry(const MediaEntry& entry) {
 }
 
 std::vector<MediaEntry> LibraryDatabase::search(const std::string& query) const {
+    std::scoped_lock lock(mutex_);
     std::vector<MediaEntry> results;
     if (!db_) {
         return results;
@@ -113,4 +147,141 @@ std::vector<MediaEntry> LibraryDatabase::search(const std::string& query) const
     return results;
 }
 
+std::optional<ProbeCacheEntry> LibraryDatabase::find_probe(const std::filesystem::path& path, uint64_t file_size, int64_t modified_time) const {
+    std::scoped_lock lock(mutex_);
+    if (!db_) {
+        return std::nullopt;
+    }
+    const char* sql = R"SQL(
+        SELECT format_name, streams, extradata
+        FROM probe_cache
+        WHERE path = ?1 AND file_size = ?2 AND modified_time = ?3;
+    )SQL";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        throw std::runtime_error("Failed to prepare probe lookup");
+    }
+    sqlite3_bind_text(stmt, 1, path.string().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(file_size));
+    sqlite3_bind_int64(stmt, 3, modified_time);
+
+    std::optional<ProbeCacheEntry> result;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        ProbeCacheEntry entry;
+        entry.file_size = file_size;
+        entry.modified_time = modified_time;
+        if (const auto* name = sqlite3_column_text(stmt, 0)) {
+            entry.format_name = reinterpret_cast<const char*>(name);
+        }
+        if (const auto* streams = sqlite3_column_text(stmt, 1)) {
+            entry.streams = reinterpret_cast<const char*>(streams);
+        }
+        const auto* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 2));
+        int blob_size = sqlite3_column_bytes(stmt, 2);
+        if (blob && blob_size > 0) {
+            entry.extradata.assign(blob, blob + blob_size);
+        }
+        result = std::move(entry);
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+void LibraryDatabase::store_probe(const std::filesystem::path& path, const ProbeCacheEntry& entry) {
+    std::scoped_lock lock(mutex_);
+    if (!db_) {
+        throw std::runtime_error("Database not opened");
+    }
+    const char* sql = R"SQL(
+        INSERT INTO probe_cache (path, file_size, modified_time, format_name, streams, extradata)
+        VALUES (?1, ?2, ?3, ?4, ?5, ?6)
+        ON CONFLICT(path) DO UPDATE SET
+            file_size = excluded.file_size,
+            modified_time = excluded.modified_time,
+            format_name = excluded.format_name,
+            streams = excluded.streams,
+            extradata = excluded.extradata;
+    )SQL";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        throw std::runtime_error("Failed to prepare statement");
+    }
+    sqlite3_bind_text(stmt, 1, path.string().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(entry.file_size));
+    sqlite3_bind_int64(stmt, 3, entry.modified_time);
+    sqlite3_bind_text(stmt, 4, entry.format_name.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, entry.streams.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_blob(stmt, 6, entry.extradata.data(), static_cast<int>(entry.extradata.size()), SQLITE_TRANSIENT);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        sqlite3_finalize(stmt);
+        throw std::runtime_error("Failed to store probe result");
+    }
+    sqlite3_finalize(stmt);
+}
+
+std::optional<KeyframeIndexRecord> LibraryDatabase::find_keyframe_index(const std::filesystem::path& path, const FileStamp& stamp) const {
+    std::scoped_lock lock(mutex_);
+    if (!db_) {
+        return std::nullopt;
+    }
+    const char* sql = R"SQL(
+        SELECT stream_index, entries
+        FROM keyframe_index
+        WHERE path = ?1 AND file_size = ?2 AND modified_time = ?3;
+    )SQL";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        throw std::runtime_error("Failed to prepare keyframe index lookup");
+    }
+    sqlite3_bind_text(stmt, 1, path.string().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(stamp.size));
+    sqlite3_bind_int64(stmt, 3, stamp.modified_time);
+
+    std::optional<KeyframeIndexRecord> result;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        KeyframeIndexRecord record;
+        record.stream_index = sqlite3_column_int(stmt, 0);
+        const auto* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 1));
+        int blob_size = sqlite3_column_bytes(stmt, 1);
+        if (blob && blob_size > 0) {
+            record.entries.assign(blob, blob + blob_size);
+        }
+        result = std::move(record);
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+void LibraryDatabase::store_keyframe_index(const std::filesystem::path& path, const FileStamp& stamp, const KeyframeIndexRecord& record) {
+    std::scoped_lock lock(mutex_);
+    if (!db_) {
+        throw std::runtime_error("Database not opened");
+    }
+    const char* sql = R"SQL(
+        INSERT INTO keyframe_index (path, file_size, modified_time, stream_index, entries)
+        VALUES (?1, ?2, ?3, ?4, ?5)
+        ON CONFLICT(path) DO UPDATE SET
+            file_size = excluded.file_size,
+            modified_time = excluded.modified_time,
+            stream_index = excluded.stream_index,
+            entries = excluded.entries;
+    )SQL";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        throw std::runtime_error("Failed to prepare statement");
+    }
+    sqlite3_bind_text(stmt, 1, path.string().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(stamp.size));
+    sqlite3_bind_int64(stmt, 3, stamp.modified_time);
+    sqlite3_bind_int(stmt, 4, record.stream_index);
+    sqlite3_bind_blob(stmt, 5, record.entries.data(), static_cast<int>(record.entries.size()), SQLITE_TRANSIENT);
+
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        sqlite3_finalize(stmt);
+        throw std::runtime_error("Failed to store keyframe index");
+    }
+    sqlite3_finalize(stmt);
+}
+
 } // namespace raha::core
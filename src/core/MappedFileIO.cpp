@@ -0,0 +1,139 @@
+#include "raha/core/MappedFileIO.hpp"
+
+#include "raha/utils/Logger.hpp"
+
+extern "C" {
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RAHA_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace raha::core {
+
+namespace {
+constexpr int io_buffer_size = 256 * 1024;
+
+} // namespace
+
+MappedFileIO::MappedFileIO() = default;
+MappedFileIO::~MappedFileIO() { close(); }
+
+bool MappedFileIO::open(const std::filesystem::path& path) {
+    close();
+#if defined(RAHA_HAS_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced, the descriptor is no longer needed.
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        utils::get_logger()->debug("mmap failed for {}, using buffered I/O", path.string());
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+    size_ = static_cast<std::size_t>(info.st_size);
+    position_ = 0;
+
+    auto* buffer = static_cast<unsigned char*>(av_malloc(io_buffer_size));
+    if (!buffer) {
+        close();
+        return false;
+    }
+    io_ctx_ = avio_alloc_context(buffer, io_buffer_size, 0, this, &MappedFileIO::read_packet, nullptr, &MappedFileIO::seek);
+    if (!io_ctx_) {
+        av_free(buffer);
+        close();
+        return false;
+    }
+    advise(AccessPattern::Sequential);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void MappedFileIO::close() {
+    if (io_ctx_) {
+        av_freep(&io_ctx_->buffer);
+        avio_context_free(&io_ctx_);
+    }
+#if defined(RAHA_HAS_MMAP)
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    position_ = 0;
+}
+
+void MappedFileIO::advise(AccessPattern pattern) {
+#if defined(RAHA_HAS_MMAP)
+    if (!data_) {
+        return;
+    }
+    int advice = pattern == AccessPattern::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM;
+    madvise(const_cast<uint8_t*>(data_), size_, advice);
+#else
+    (void)pattern;
+#endif
+}
+
+int MappedFileIO::read_packet(void* opaque, uint8_t* buffer, int buffer_size) {
+    auto* self = static_cast<MappedFileIO*>(opaque);
+    if (self->position_ >= self->size_) {
+        return AVERROR_EOF;
+    }
+    std::size_t count = std::min(static_cast<std::size_t>(buffer_size), self->size_ - self->position_);
+    std::memcpy(buffer, self->data_ + self->position_, count);
+    self->position_ += count;
+    return static_cast<int>(count);
+}
+
+int64_t MappedFileIO::seek(void* opaque, int64_t offset, int whence) {
+    auto* self = static_cast<MappedFileIO*>(opaque);
+    const auto size = static_cast<int64_t>(self->size_);
+    if (whence == AVSEEK_SIZE) {
+        return size;
+    }
+    int64_t target = 0;
+    switch (whence & ~AVSEEK_FORCE) {
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = static_cast<int64_t>(self->position_) + offset;
+        break;
+    case SEEK_END:
+        target = size + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (target < 0 || target > size) {
+        return AVERROR(EINVAL);
+    }
+    self->position_ = static_cast<std::size_t>(target);
+    return target;
+}
+
+} // namespace raha::core
@@ -0,0 +1,55 @@
+#include "raha/core/MasterClock.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace raha::core {
+
+MasterClock::MasterClock(SyncTuning tuning) : tuning_(tuning) {}
+
+SyncMode MasterClock::effective_mode(bool audio_available) const {
+    if (mode_ == SyncMode::Audio && !audio_available) {
+        return SyncMode::Video;
+    }
+    return mode_;
+}
+
+void MasterClock::reset() {
+    average_ = 0.0;
+    rate_ = 1.0;
+    samples_ = 0;
+}
+
+SyncCorrection MasterClock::update(double master_time, double follower_time) {
+    const double diff = master_time - follower_time;
+    ++samples_;
+    // A plain mean until the warmup is complete, so the first readings count equally.
+    const double weight = samples_ <= tuning_.warmup_samples ? 1.0 / samples_ : tuning_.average_weight;
+    average_ += (diff - average_) * weight;
+
+    SyncCorrection correction;
+    if (samples_ < tuning_.warmup_samples) {
+        correction.rate = rate_;
+        return correction;
+    }
+    if (std::abs(average_) > tuning_.resync_threshold) {
+        correction.jump = diff;
+        ++resyncs_;
+        reset();
+        return correction;
+    }
+    rate_ = 1.0 + std::clamp(average_ / tuning_.convergence_seconds, -tuning_.max_correction, tuning_.max_correction);
+    correction.rate = rate_;
+    return correction;
+}
+
+SyncStats MasterClock::stats(bool audio_available) const {
+    SyncStats stats;
+    stats.mode = effective_mode(audio_available);
+    stats.drift = average_;
+    stats.rate = rate_;
+    stats.resyncs = resyncs_;
+    return stats;
+}
+
+} // namespace raha::core
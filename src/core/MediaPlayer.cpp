@@ -7,6 +7,9 @@ extern "C" {
 #include <libavutil/frame.h>
 }
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <optional>
 #include <stdexcept>
@@ -21,6 +24,10 @@ SDL_Window* validate_window(SDL_Window* window) {
     return window;
 }
 
+double steady_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 } // namespace
 
 MediaPlayer::MediaPlayer() : workers_(2) {}
@@ -30,6 +37,22 @@ bool MediaPlayer::initialize(SDL_Window* window, SDL_Renderer* renderer) {
     validate_window(window);
     subtitle_manager_.initialize();
     video_renderer_.initialize(window, renderer);
+    video_renderer_.configure(config_.render);
+    // The nominal rate seeds the pacer, which then measures the real one.
+    SDL_DisplayMode mode {};
+    double refresh_interval = 1.0 / 60.0;
+    if (SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0) {
+        refresh_interval = 1.0 / mode.refresh_rate;
+    }
+    pacer_.reset(refresh_interval);
+    wake_event_ = SDL_RegisterEvents(1);
+    decoder_.set_frame_callback([this] {
+        if (wake_event_ != static_cast<Uint32>(-1) && wake_armed_.exchange(false)) {
+            SDL_Event event {};
+            event.type = wake_event_;
+            SDL_PushEvent(&event);
+        }
+    });
     state_ = PlayerState::Idle;
     running_ = true;
     playback_clock_.stop();
@@ -41,6 +64,7 @@ bool MediaPlayer::initialize(SDL_Window* window, SDL_Renderer* renderer) {
 void MediaPlayer::shutdown() {
     running_ = false;
     stop();
+    cancel_keyframe_index();
     audio_renderer_.shutdown();
     video_renderer_.shutdown();
     subtitle_manager_.shutdown();
@@ -56,22 +80,36 @@ void MediaPlayer::shutdown() {
 bool MediaPlayer::open(const std::string& uri) {
     std::scoped_lock lock(playback_mutex_);
     utils::get_logger()->info("Opening media: {}", uri);
-    if (!source_.open(uri)) {
+    cancel_keyframe_index();
+    end_reverse();
+    // The refill thread pulls from the decoder that is about to be replaced.
+    audio_renderer_.shutdown();
+    if (!source_.open(uri, config_.io, library_)) {
         state_ = PlayerState::Error;
         return false;
     }
-    if (!decoder_.prepare(source_)) {
+    decoder_.set_playback_speed(config_.playback.playback_speed);
+    trick_play_active_ = false;
+    decoder_.set_keyframes_only(false);
+    if (!decoder_.prepare(source_, config_.decoder)) {
         utils::get_logger()->error("Failed to prepare decoder");
         state_ = PlayerState::Error;
         return false;
     }
-    if (!audio_renderer_.initialize(decoder_.audio_context())) {
+    if (auto audio_context = decoder_.audio_context();
+        audio_context && !audio_renderer_.initialize(audio_context.get(), config_.audio, [this] { return decoder_.next_audio_frame(); })) {
         utils::get_logger()->warn("Audio renderer initialization failed");
     }
+    audio_renderer_.set_speed(config_.playback.playback_speed);
+    update_trick_play();
+    start_keyframe_index(uri);
     state_ = PlayerState::Ready;
+    stats_ = {};
+    master_clock_.reset();
     config_.last_media_path = std::filesystem::path(uri);
     config_.last_position_seconds = 0.0;
     playback_clock_.stop();
+    video_renderer_.flush();
     pending_video_frame_.reset();
     has_pending_video_ = false;
     return true;
@@ -79,6 +117,8 @@ bool MediaPlayer::open(const std::string& uri) {
 
 void MediaPlayer::close() {
     stop();
+    cancel_keyframe_index();
+    audio_renderer_.shutdown();
     decoder_.shutdown();
     source_.close();
     playback_clock_.stop();
@@ -88,6 +128,9 @@ void MediaPlayer::close() {
 }
 
 void MediaPlayer::play() {
+    if (reverse_stepping_) {
+        set_reverse(false);
+    }
     if (state_ == PlayerState::Ready || state_ == PlayerState::Stopped) {
         double start_time = config_.last_position_seconds.value_or(0.0);
         playback_clock_.set_speed(config_.playback.playback_speed);
@@ -97,20 +140,36 @@ void MediaPlayer::play() {
         playback_clock_.resume();
         state_ = PlayerState::Playing;
     }
+    if (state_ == PlayerState::Playing) {
+        master_clock_.reset();
+        trick_play_.reset(playback_clock_.current_time());
+        if (reverse_) {
+            reverse_clock_.resume();
+        }
+        audio_renderer_.set_paused(reverse_);
+    }
 }
 
 void MediaPlayer::pause() {
     if (state_ == PlayerState::Playing) {
         state_ = PlayerState::Paused;
+        audio_renderer_.set_paused(true);
         playback_clock_.pause();
-        config_.last_position_seconds = playback_clock_.current_time();
+        if (reverse_) {
+            // Already the frame on screen.
+            reverse_clock_.pause();
+        } else {
+            config_.last_position_seconds = playback_clock_.current_time();
+        }
     }
 }
 
 void MediaPlayer::stop() {
+    end_reverse();
     if (state_ == PlayerState::Playing || state_ == PlayerState::Paused) {
         state_ = PlayerState::Stopped;
     }
+    audio_renderer_.set_paused(true);
     audio_renderer_.clear();
     playback_clock_.stop();
     config_.last_position_seconds = 0.0;
@@ -118,32 +177,282 @@ void MediaPlayer::stop() {
     has_pending_video_ = false;
 }
 
-bool MediaPlayer::seek(double seconds) {
-    if (!decoder_.seek(seconds)) {
+bool MediaPlayer::seek(double seconds, std::optional<int64_t> byte_position, bool exact) {
+    if (reverse_stepping_) {
+        end_reverse();
+    }
+    if (reverse_) {
+        // Reverse playback carries on backwards from the new position.
+        show_seek_frame_ = state_ != PlayerState::Playing;
+        return start_reverse(seconds);
+    }
+    if (!decoder_.seek(seconds, byte_position, exact)) {
         return false;
     }
     if (config_.subtitles.subtitle_delay != 0.0) {
         // For now we rely on libass internal timing.
     }
     audio_renderer_.clear();
+    master_clock_.reset();
+    video_renderer_.flush();
     pending_video_frame_.reset();
     has_pending_video_ = false;
     config_.last_position_seconds = seconds;
-    if (state_ == PlayerState::Playing) {
-        playback_clock_.set_speed(config_.playback.playback_speed);
-        playback_clock_.start(seconds);
-    } else {
-        playback_clock_.stop();
+    trick_play_.reset(seconds);
+    show_seek_frame_ = state_ != PlayerState::Playing;
+    playback_clock_.set_speed(config_.playback.playback_speed);
+    playback_clock_.start(seconds);
+    if (state_ != PlayerState::Playing) {
+        // Held at the new position, so resuming from pause continues there.
+        playback_clock_.pause();
     }
     return true;
 }
 
+std::shared_ptr<const KeyframeIndex> MediaPlayer::keyframe_index() const {
+    std::scoped_lock lock(index_mutex_);
+    return keyframe_index_;
+}
+
+void MediaPlayer::start_keyframe_index(const std::string& uri) {
+    auto video_index = source_.video_stream_index();
+    if (!library_ || !video_index) {
+        return;
+    }
+    auto stamp = file_stamp(uri);
+    if (!stamp) {
+        return;
+    }
+    const AVRational time_base = source_.raw()->streams[*video_index]->time_base;
+    try {
+        if (auto record = library_->find_keyframe_index(uri, *stamp); record && record->stream_index == *video_index) {
+            if (auto index = KeyframeIndex::decode(record->entries, record->stream_index, time_base)) {
+                std::scoped_lock lock(index_mutex_);
+                keyframe_index_ = std::make_shared<const KeyframeIndex>(std::move(*index));
+                return;
+            }
+        }
+    } catch (const std::exception& e) {
+        utils::get_logger()->warn("Keyframe index lookup failed: {}", e.what());
+    }
+
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    index_cancel_ = cancel;
+    index_task_ = workers_.enqueue([this, uri, stream = *video_index, stamp = *stamp, cancel] {
+        auto index = KeyframeIndex::build(uri, stream, *cancel);
+        if (!index || index->empty() || *cancel) {
+            return;
+        }
+        try {
+            library_->store_keyframe_index(uri, stamp, KeyframeIndexRecord {stream, index->encode()});
+        } catch (const std::exception& e) {
+            utils::get_logger()->warn("Failed to store keyframe index: {}", e.what());
+        }
+        std::scoped_lock lock(index_mutex_);
+        if (!*cancel) {
+            keyframe_index_ = std::make_shared<const KeyframeIndex>(std::move(*index));
+        }
+    });
+}
+
+void MediaPlayer::cancel_keyframe_index() {
+    if (index_cancel_) {
+        *index_cancel_ = true;
+    }
+    if (index_task_.valid()) {
+        index_task_.wait();
+    }
+    index_cancel_.reset();
+    index_task_ = {};
+    std::scoped_lock lock(index_mutex_);
+    keyframe_index_.reset();
+}
+
 void MediaPlayer::set_playback_speed(double speed) {
     config_.playback.playback_speed = speed;
     playback_clock_.set_speed(speed);
+    reverse_clock_.set_speed(speed);
+    audio_renderer_.set_speed(speed);
+    decoder_.set_playback_speed(speed);
+    // Audio already buffered still plays at the old speed; the next correction starts over.
+    master_clock_.reset();
+    update_trick_play();
+}
+
+void MediaPlayer::update_trick_play() {
+    trick_play_.set_threshold(config_.playback.trick_play_above_speed);
+    const bool engaged = source_.video_stream_index().has_value() && trick_play_.engaged(config_.playback.playback_speed);
+    audio_renderer_.set_silenced(engaged && !config_.playback.trick_play_audio);
+    if (engaged == trick_play_active_) {
+        return;
+    }
+    trick_play_active_ = engaged;
+    trick_play_.set_active(engaged);
+    trick_play_.reset(current_time());
+    decoder_.set_keyframes_only(engaged);
+    reverse_decoder_.set_keyframes_only(engaged);
+    utils::get_logger()->info("Trick play {} at {}x", engaged ? "on" : "off", config_.playback.playback_speed);
+    if (!engaged && !reverse_ && (state_ == PlayerState::Playing || state_ == PlayerState::Paused)) {
+        // Without this the picture would hold until the next keyframe.
+        seek(current_time(), std::nullopt, true);
+    }
+}
+
+void MediaPlayer::trick_play_skip(double seconds) {
+    if (auto index = keyframe_index(); index && !index->empty()) {
+        const auto& entries = index->entries();
+        const int64_t target = av_rescale_q(static_cast<int64_t>(seconds * AV_TIME_BASE), AV_TIME_BASE_Q, index->time_base());
+        auto next = std::lower_bound(entries.begin(), entries.end(), target,
+                                     [](const KeyframeEntry& entry, int64_t pts) { return entry.pts < pts; });
+        if (next == entries.end()) {
+            // No keyframe left ahead; the decoder reaches the end on its own.
+            return;
+        }
+        seconds = next->pts * av_q2d(index->time_base());
+    }
+    if ((duration() > 0.0 && seconds >= duration()) || !decoder_.seek(seconds)) {
+        return;
+    }
+    audio_renderer_.clear();
+    master_clock_.reset();
+    video_renderer_.flush();
+    pending_video_frame_.reset();
+    has_pending_video_ = false;
+}
+
+bool MediaPlayer::set_reverse(bool reverse) {
+    if (reverse == reverse_) {
+        // A step back turns into reverse playback when asked for it.
+        reverse_stepping_ = false;
+        return true;
+    }
+    if (reverse) {
+        return start_reverse(current_time());
+    }
+    const double position = current_time();
+    end_reverse();
+    // Forward decoding picks up at the frame reverse playback stopped on.
+    const bool ok = seek(position, std::nullopt, true);
+    if (state_ == PlayerState::Playing) {
+        audio_renderer_.set_paused(false);
+    }
+    return ok;
+}
+
+bool MediaPlayer::step_back() {
+    const auto shown = video_renderer_.displayed_pts();
+    pause();
+    if (!reverse_) {
+        if (!start_reverse(shown.value_or(current_time()))) {
+            return false;
+        }
+        reverse_stepping_ = true;
+    }
+    show_seek_frame_ = true;
+    return true;
+}
+
+bool MediaPlayer::start_reverse(double from) {
+    auto video_index = source_.video_stream_index();
+    if (!video_index) {
+        return false;
+    }
+    const AVStream* stream = source_.raw()->streams[*video_index];
+    reverse_frame_duration_ = stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0 ? av_q2d(av_inv_q(stream->avg_frame_rate)) : 1.0 / 30.0;
+    reverse_decoder_.set_memory_limit(static_cast<std::size_t>(std::max(config_.playback.reverse_buffer_mb, 16)) * 1024U * 1024U);
+    reverse_decoder_.set_keyframes_only(trick_play_active_);
+    if (!reverse_decoder_.start(source_.uri(), *video_index, from, keyframe_index())) {
+        utils::get_logger()->warn("Reverse playback unavailable for {}", source_.uri());
+        end_reverse();
+        return false;
+    }
+    reverse_ = true;
+    reverse_origin_ = from;
+    reverse_clock_.set_speed(config_.playback.playback_speed);
+    reverse_clock_.start(0.0);
+    if (state_ != PlayerState::Playing) {
+        reverse_clock_.pause();
+    }
+    audio_renderer_.set_paused(true);
+    video_renderer_.flush();
+    pending_video_frame_.reset();
+    has_pending_video_ = false;
+    config_.last_position_seconds = from;
+    return true;
+}
+
+void MediaPlayer::end_reverse() {
+    if (!reverse_) {
+        return;
+    }
+    reverse_decoder_.stop();
+    reverse_clock_.stop();
+    reverse_ = false;
+    reverse_stepping_ = false;
+    pending_video_frame_.reset();
+    has_pending_video_ = false;
+}
+
+double MediaPlayer::reverse_time() const {
+    return std::max(0.0, reverse_origin_ - reverse_clock_.current_time());
+}
+
+void MediaPlayer::update_reverse() {
+    // Nothing posts a wake event for reverse frames; next_wakeup() polls for them.
+    wake_armed_ = false;
+    const AVRational time_base = reverse_decoder_.time_base();
+    auto fill_pending = [&] {
+        if (!has_pending_video_) {
+            if (auto frame = reverse_decoder_.next_frame()) {
+                pending_video_pts_ = (*frame)->pts * av_q2d(time_base);
+                pending_video_frame_ = std::move(*frame);
+                has_pending_video_ = true;
+            }
+        }
+        return has_pending_video_;
+    };
+    if (state_ != PlayerState::Playing) {
+        if (show_seek_frame_ && fill_pending()) {
+            video_renderer_.render_frame(pending_video_frame_.get(), config_.video_adjustments);
+            config_.last_position_seconds = pending_video_pts_;
+            pending_video_frame_.reset();
+            has_pending_video_ = false;
+            show_seek_frame_ = false;
+        }
+        return;
+    }
+    show_seek_frame_ = false;
+
+    // Frames arrive newest first. Each covers a frame duration from its pts, so it is due
+    // once the clock has come back below its end; of several due frames the oldest wins.
+    const double clock_time = reverse_time();
+    FramePtr due_frame;
+    double due_pts = 0.0;
+    while (fill_pending() && pending_video_pts_ + reverse_frame_duration_ > clock_time) {
+        if (due_frame) {
+            ++stats_.dropped;
+        }
+        due_frame = std::move(pending_video_frame_);
+        due_pts = pending_video_pts_;
+        has_pending_video_ = false;
+    }
+    if (due_frame) {
+        // Without a pts the ring shows it at the next present, after any frame rendered
+        // before it; reverse pts would run against its forward ordering.
+        video_renderer_.render_frame(due_frame.get(), config_.video_adjustments);
+        ++stats_.rendered;
+        config_.last_position_seconds = due_pts;
+    }
+    if (!has_pending_video_ && reverse_decoder_.finished()) {
+        // The start of the stream: hold the first frame.
+        pause();
+    }
 }
 
 double MediaPlayer::current_time() const {
+    if (reverse_ && state_ == PlayerState::Playing) {
+        return reverse_time();
+    }
     if (state_ == PlayerState::Playing) {
         return playback_clock_.current_time();
     }
@@ -151,9 +460,27 @@ double MediaPlayer::current_time() const {
 }
 
 void MediaPlayer::update() {
+    // Armed before the queues are checked so a frame decoded in between still wakes the
+    // loop; disarmed below once nothing is waiting on the decoder.
+    wake_armed_ = true;
+    if (reverse_) {
+        update_reverse();
+        return;
+    }
     if (state_ != PlayerState::Playing) {
+        if (!show_seek_frame_) {
+            wake_armed_ = false;
+        } else {
+            if (auto frame = decoder_.next_video_frame()) {
+                video_renderer_.render_frame(frame->get(), config_.video_adjustments);
+                show_seek_frame_ = false;
+                wake_armed_ = false;
+            }
+        }
         return;
     }
+    show_seek_frame_ = false;
+    synchronize();
     const double clock_time = playback_clock_.current_time();
     config_.last_position_seconds = clock_time;
 
@@ -177,32 +504,24 @@ void MediaPlayer::update() {
         return pts * av_q2d(video_stream->time_base);
     };
 
-    auto try_render = [&](FramePtr& frame_holder, bool& has_frame, double& stored_pts) {
-        if (!frame_holder) {
-            has_frame = false;
-            return false;
+    // Only the newest due frame is converted and uploaded; anything it supersedes is
+    // dropped untouched so a player that fell behind can catch up.
+    FramePtr due_frame;
+    double due_pts = 0.0;
+    auto take_due = [&](FramePtr frame, double pts_value) {
+        if (due_frame) {
+            ++stats_.dropped;
         }
-        auto pts_opt = frame_time_seconds(frame_holder.get());
-        double pts_value = pts_opt.value_or(clock_time);
-        if (pts_value <= clock_time + video_sync_tolerance_) {
-            video_renderer_.render_frame(frame_holder.get(), config_.video_adjustments);
-            config_.last_position_seconds = pts_value;
-            frame_holder.reset();
-            has_frame = false;
-            return true;
-        }
-        stored_pts = pts_value;
-        has_frame = true;
-        return false;
+        due_frame = std::move(frame);
+        due_pts = pts_value;
     };
 
-    if (has_pending_video_) {
-        if (!try_render(pending_video_frame_, has_pending_video_, pending_video_pts_)) {
-            return;
-        }
+    if (has_pending_video_ && pending_video_pts_ <= clock_time + video_sync_tolerance_) {
+        take_due(std::move(pending_video_frame_), pending_video_pts_);
+        has_pending_video_ = false;
     }
 
-    while (true) {
+    while (!has_pending_video_) {
         auto video_frame_opt = decoder_.next_video_frame();
         if (!video_frame_opt) {
             break;
@@ -216,18 +535,164 @@ void MediaPlayer::update() {
             has_pending_video_ = true;
             break;
         }
-        video_renderer_.render_frame(frame.get(), config_.video_adjustments);
-        config_.last_position_seconds = pts_value;
+        take_due(std::move(frame), pts_value);
+    }
+
+    // A frame that is still too late after that is dropped as well. Trick play trails the
+    // clock by design and is left to skip_target().
+    const double now = steady_seconds();
+    if (due_frame && config_.playback.drop_late_frames && !trick_play_active_
+        && clock_time - due_pts > config_.playback.late_frame_threshold && now - last_render_time_ < max_render_gap_) {
+        due_frame.reset();
+        ++stats_.dropped;
+        ++stats_.late;
+    }
+
+    if (due_frame) {
+        video_renderer_.render_frame(due_frame.get(), config_.video_adjustments, due_pts);
+        ++stats_.rendered;
+        last_render_time_ = now;
+        trick_play_.frame_shown(due_pts);
+        config_.last_position_seconds = due_pts;
+        if (video_stream) {
+            const AVCodecParameters* params = video_stream->codecpar;
+            decoder_.set_lowres_hint(video_renderer_.lowres_for(params->width, params->height));
+        }
+    }
+
+    // The next frame is uploaded into a spare texture before it is due; present() switches
+    // to it at the matching vsync, so upload time no longer competes with that deadline.
+    if (has_pending_video_ && pending_video_pts_ <= clock_time + prepare_ahead_ && video_renderer_.can_prepare()) {
+        video_renderer_.render_frame(pending_video_frame_.get(), config_.video_adjustments, pending_video_pts_);
+        ++stats_.rendered;
+        last_render_time_ = now;
+        trick_play_.frame_shown(pending_video_pts_);
+        pending_video_frame_.reset();
+        has_pending_video_ = false;
+    }
+
+    if (trick_play_active_) {
+        if (auto target = trick_play_.skip_target(clock_time, config_.playback.playback_speed, steady_seconds())) {
+            trick_play_skip(*target);
+        }
     }
 
-    auto audio_frame_opt = decoder_.next_audio_frame();
-    if (audio_frame_opt) {
-        audio_renderer_.queue_frame(audio_frame_opt->get());
+    if (has_pending_video_ || !video_stream) {
+        wake_armed_ = false;
     }
 }
 
+bool MediaPlayer::audio_can_lead() const {
+    // Trick play skips around and may mute audio; the playback clock leads instead.
+    return audio_renderer_.active() && !trick_play_active_;
+}
+
+void MediaPlayer::synchronize() {
+    master_clock_.set_mode(config_.playback.sync_mode);
+    const SyncMode mode = master_clock_.effective_mode(audio_can_lead());
+    if (mode != sync_mode_) {
+        sync_mode_ = mode;
+        master_clock_.reset();
+        audio_renderer_.set_resample_rate(1.0);
+        playback_clock_.set_speed(config_.playback.playback_speed);
+    }
+    if (!audio_renderer_.active()) {
+        return;
+    }
+    auto audio_time = audio_renderer_.clock();
+    if (!audio_time) {
+        return;
+    }
+    // audio_delay moves what is heard relative to the picture.
+    const double heard_time = *audio_time + config_.audio.audio_delay;
+    const double video_time = playback_clock_.current_time();
+    if (mode == SyncMode::Audio) {
+        auto correction = master_clock_.update(heard_time, video_time);
+        if (correction.jump) {
+            playback_clock_.start(video_time + *correction.jump);
+        }
+        const double target = config_.playback.playback_speed * correction.rate;
+        if (std::abs(playback_clock_.speed() - target) > 1e-6) {
+            playback_clock_.set_speed(target);
+        }
+        return;
+    }
+    auto correction = master_clock_.update(video_time, heard_time);
+    if (correction.jump) {
+        audio_renderer_.shift(*correction.jump);
+    }
+    audio_renderer_.set_resample_rate(correction.rate);
+}
+
+std::optional<double> MediaPlayer::next_wakeup() const {
+    if (reverse_) {
+        // The reverse decoder announces nothing, so frames it has not produced yet are
+        // polled for once per refresh.
+        if (state_ != PlayerState::Playing) {
+            return show_seek_frame_ ? std::optional<double>(pacer_.refresh_interval()) : std::nullopt;
+        }
+        if (!has_pending_video_) {
+            return pacer_.refresh_interval();
+        }
+        const double due = reverse_time() - (pending_video_pts_ + reverse_frame_duration_);
+        return std::max(0.0, due / std::max(reverse_clock_.speed(), 0.01));
+    }
+    if (state_ != PlayerState::Playing) {
+        return std::nullopt;
+    }
+    const double clock_time = playback_clock_.current_time();
+    const double speed = std::max(playback_clock_.speed(), 0.01);
+    std::optional<double> wait;
+    auto consider = [&wait](double seconds) {
+        seconds = std::max(0.0, seconds);
+        wait = wait ? std::min(*wait, seconds) : seconds;
+    };
+    if (has_pending_video_ && video_renderer_.can_prepare()) {
+        consider((pending_video_pts_ - prepare_ahead_ - clock_time) / speed);
+    }
+    if (auto pts = video_renderer_.next_prepared_pts()) {
+        // One refresh early, so the present that blocks on vsync lands on the right one.
+        consider((*pts - clock_time) / speed - pacer_.refresh_interval());
+    }
+    return wait;
+}
+
 void MediaPlayer::present() {
-    video_renderer_.present();
+    // What is drawn now reaches the screen at the next vsync, so the frame is chosen for
+    // that moment rather than for the current clock.
+    double display_time = playback_clock_.current_time();
+    if (state_ == PlayerState::Playing) {
+        display_time = pacer_.display_time(steady_seconds(), display_time, playback_clock_.speed());
+    }
+    presented_new_frame_ = video_renderer_.present(display_time);
+}
+
+void MediaPlayer::frame_presented() {
+    pacer_.record_present(steady_seconds());
+    if (presented_new_frame_) {
+        pacer_.record_frame_shown();
+        presented_new_frame_ = false;
+    }
+    // Only a video master may be nudged; audio then follows it by resampling.
+    if (!config_.playback.display_sync || state_ != PlayerState::Playing || sync_mode_ != SyncMode::Video) {
+        return;
+    }
+    auto video_index = source_.video_stream_index();
+    if (!video_index) {
+        return;
+    }
+    const AVRational rate = source_.raw()->streams[*video_index]->avg_frame_rate;
+    if (rate.num <= 0 || rate.den <= 0) {
+        return;
+    }
+    const double target = config_.playback.playback_speed * pacer_.clock_correction(av_q2d(av_inv_q(rate)), max_clock_correction_);
+    if (std::abs(playback_clock_.speed() - target) > 1e-6) {
+        playback_clock_.set_speed(target);
+    }
+}
+
+void MediaPlayer::resize(int width, int height) {
+    video_renderer_.resize(width, height);
 }
 
 void MediaPlayer::toggle_mute() {
@@ -241,6 +706,11 @@ void MediaPlayer::set_volume(float volume) {
     config_.audio.volume = volume;
 }
 
+void MediaPlayer::set_balance(float balance) {
+    audio_renderer_.set_balance(balance);
+    config_.audio.balance = balance;
+}
+
 void MediaPlayer::set_video_adjustments(const VideoAdjustments& adjustments) {
     config_.video_adjustments = adjustments;
 }
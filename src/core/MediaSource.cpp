@@ -4,34 +4,215 @@
 
 extern "C" {
 #include <libavutil/avutil.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/dict.h>
+#include <libavutil/mem.h>
 }
 
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <stdexcept>
+#include <type_traits>
 
 namespace raha::core {
 
+namespace {
+bool is_local_file(const std::string& path) {
+    if (path.find("://") != std::string::npos) {
+        return false;
+    }
+    std::error_code ec;
+    return std::filesystem::is_regular_file(path, ec);
+}
+
+// Probing only has to recognise the container and read its header when the stream
+// parameters come from the cache.
+constexpr const char* cached_probesize = "32768";
+constexpr const char* cached_analyzeduration = "0";
+constexpr int64_t default_probesize = 5'000'000;
+
+nlohmann::json rational_to_json(AVRational value) {
+    return nlohmann::json::array({value.num, value.den});
+}
+
+AVRational rational_from_json(const nlohmann::json& value) {
+    if (!value.is_array() || value.size() != 2) {
+        return AVRational {0, 1};
+    }
+    return AVRational {value[0].get<int>(), value[1].get<int>()};
+}
+
+template <typename Field>
+void read_field(const nlohmann::json& j, const char* key, Field& field) {
+    if (auto it = j.find(key); it != j.end() && it->is_number()) {
+        if constexpr (std::is_enum_v<Field>) {
+            field = static_cast<Field>(it->get<int>());
+        } else {
+            field = it->get<Field>();
+        }
+    }
+}
+
+nlohmann::json stream_to_json(const AVStream* stream) {
+    const AVCodecParameters* par = stream->codecpar;
+    nlohmann::json j = {
+        {"codec_type", static_cast<int>(par->codec_type)},
+        {"codec_id", static_cast<int>(par->codec_id)},
+        {"codec_tag", par->codec_tag},
+        {"format", par->format},
+        {"bit_rate", par->bit_rate},
+        {"bits_per_coded_sample", par->bits_per_coded_sample},
+        {"bits_per_raw_sample", par->bits_per_raw_sample},
+        {"profile", par->profile},
+        {"level", par->level},
+        {"width", par->width},
+        {"height", par->height},
+        {"sample_aspect_ratio", rational_to_json(par->sample_aspect_ratio)},
+        {"field_order", static_cast<int>(par->field_order)},
+        {"color_range", static_cast<int>(par->color_range)},
+        {"color_primaries", static_cast<int>(par->color_primaries)},
+        {"color_trc", static_cast<int>(par->color_trc)},
+        {"color_space", static_cast<int>(par->color_space)},
+        {"chroma_location", static_cast<int>(par->chroma_location)},
+        {"video_delay", par->video_delay},
+        {"channels", par->ch_layout.nb_channels},
+        {"channel_mask", par->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ? par->ch_layout.u.mask : 0},
+        {"sample_rate", par->sample_rate},
+        {"block_align", par->block_align},
+        {"frame_size", par->frame_size},
+        {"initial_padding", par->initial_padding},
+        {"seek_preroll", par->seek_preroll},
+        {"extradata_size", par->extradata_size},
+        {"time_base", rational_to_json(stream->time_base)},
+        {"avg_frame_rate", rational_to_json(stream->avg_frame_rate)},
+        {"r_frame_rate", rational_to_json(stream->r_frame_rate)},
+        {"start_time", stream->start_time},
+        {"duration", stream->duration}
+    };
+    return j;
+}
+
+void apply_stream_json(AVStream* stream, const nlohmann::json& j, const uint8_t* extradata, int extradata_size) {
+    AVCodecParameters* par = stream->codecpar;
+    read_field(j, "codec_tag", par->codec_tag);
+    read_field(j, "format", par->format);
+    read_field(j, "bit_rate", par->bit_rate);
+    read_field(j, "bits_per_coded_sample", par->bits_per_coded_sample);
+    read_field(j, "bits_per_raw_sample", par->bits_per_raw_sample);
+    read_field(j, "profile", par->profile);
+    read_field(j, "level", par->level);
+    read_field(j, "width", par->width);
+    read_field(j, "height", par->height);
+    par->sample_aspect_ratio = rational_from_json(j.value("sample_aspect_ratio", nlohmann::json()));
+    read_field(j, "field_order", par->field_order);
+    read_field(j, "color_range", par->color_range);
+    read_field(j, "color_primaries", par->color_primaries);
+    read_field(j, "color_trc", par->color_trc);
+    read_field(j, "color_space", par->color_space);
+    read_field(j, "chroma_location", par->chroma_location);
+    read_field(j, "video_delay", par->video_delay);
+    read_field(j, "sample_rate", par->sample_rate);
+    read_field(j, "block_align", par->block_align);
+    read_field(j, "frame_size", par->frame_size);
+    read_field(j, "initial_padding", par->initial_padding);
+    read_field(j, "seek_preroll", par->seek_preroll);
+
+    int channels = j.value("channels", 0);
+    uint64_t mask = j.value("channel_mask", uint64_t {0});
+    if (channels > 0 && par->ch_layout.nb_channels != channels) {
+        av_channel_layout_uninit(&par->ch_layout);
+        if (mask == 0 || av_channel_layout_from_mask(&par->ch_layout, mask) < 0) {
+            av_channel_layout_default(&par->ch_layout, channels);
+        }
+    }
+
+    if (par->extradata_size == 0 && extradata_size > 0) {
+        par->extradata = static_cast<uint8_t*>(av_mallocz(static_cast<std::size_t>(extradata_size) + AV_INPUT_BUFFER_PADDING_SIZE));
+        if (par->extradata) {
+            std::memcpy(par->extradata, extradata, static_cast<std::size_t>(extradata_size));
+            par->extradata_size = extradata_size;
+        }
+    }
+
+    auto avg_frame_rate = rational_from_json(j.value("avg_frame_rate", nlohmann::json()));
+    if (avg_frame_rate.num != 0) {
+        stream->avg_frame_rate = avg_frame_rate;
+    }
+    auto r_frame_rate = rational_from_json(j.value("r_frame_rate", nlohmann::json()));
+    if (r_frame_rate.num != 0) {
+        stream->r_frame_rate = r_frame_rate;
+    }
+    // Timestamps are only meaningful in the time base they were recorded in.
+    auto time_base = rational_from_json(j.value("time_base", nlohmann::json()));
+    if (time_base.num == stream->time_base.num && time_base.den == stream->time_base.den) {
+        if (stream->start_time == AV_NOPTS_VALUE) {
+            read_field(j, "start_time", stream->start_time);
+        }
+        if (stream->duration == AV_NOPTS_VALUE) {
+            read_field(j, "duration", stream->duration);
+        }
+    }
+}
+
+} // namespace
+
 MediaSource::MediaSource() = default;
 
 MediaSource::~MediaSource() {
     close();
 }
 
-bool MediaSource::open(const std::string& path) {
+bool MediaSource::open(const std::string& path, const IoSettings& io, LibraryDatabase* library) {
     close();
 
     auto logger = utils::get_logger();
     logger->info("Opening media source: {}", path);
 
-    if (avformat_open_input(&format_ctx_, path.c_str(), nullptr, nullptr) < 0) {
+    std::optional<FileStamp> stamp;
+    std::optional<ProbeCacheEntry> cached;
+    if (library && is_local_file(path)) {
+        stamp = file_stamp(path);
+        try {
+            if (stamp) {
+                cached = library->find_probe(path, stamp->size, stamp->modified_time);
+            }
+        } catch (const std::exception& e) {
+            logger->warn("Probe cache lookup failed: {}", e.what());
+        }
+    }
+
+    if (!open_input(path, io, cached ? &*cached : nullptr)) {
         logger->error("Failed to open media source: {}", path);
-        format_ctx_ = nullptr;
         return false;
     }
 
-    if (avformat_find_stream_info(format_ctx_, nullptr) < 0) {
-        logger->error("Failed to read stream info: {}", path);
-        close();
-        return false;
+    probed_from_cache_ = cached && apply_probe_cache(*cached);
+    if (!probed_from_cache_) {
+        if (cached) {
+            logger->debug("Probe cache entry for {} no longer matches, probing fully", path);
+            format_ctx_->probesize = default_probesize;
+            format_ctx_->max_analyze_duration = 0;
+        }
+        if (avformat_find_stream_info(format_ctx_, nullptr) < 0) {
+            logger->error("Failed to read stream info: {}", path);
+            close();
+            return false;
+        }
+        if (library && stamp) {
+            try {
+                ProbeCacheEntry entry = make_probe_cache_entry();
+                entry.file_size = stamp->size;
+                entry.modified_time = stamp->modified_time;
+                library->store_probe(path, entry);
+            } catch (const std::exception& e) {
+                logger->warn("Failed to store probe result: {}", e.what());
+            }
+        }
+    } else {
+        logger->debug("Stream parameters for {} restored from probe cache", path);
     }
 
     uri_ = path;
@@ -44,6 +225,8 @@ void MediaSource::close() {
         avformat_close_input(&format_ctx_);
         format_ctx_ = nullptr;
     }
+    mapped_io_.reset();
+    probed_from_cache_ = false;
     streams_.clear();
     uri_.clear();
     video_stream_index_.reset();
@@ -51,6 +234,123 @@ void MediaSource::close() {
     subtitle_stream_index_.reset();
 }
 
+void MediaSource::set_access_pattern(AccessPattern pattern) {
+    if (mapped_io_) {
+        mapped_io_->advise(pattern);
+    }
+}
+
+bool MediaSource::open_input(const std::string& path, const IoSettings& io, const ProbeCacheEntry* cached) {
+    const AVInputFormat* input_format = nullptr;
+    if (cached && !cached->format_name.empty()) {
+        input_format = av_find_input_format(cached->format_name.c_str());
+    }
+    auto open_with = [&](AVFormatContext* preallocated) {
+        format_ctx_ = preallocated;
+        AVDictionary* options = nullptr;
+        if (cached) {
+            av_dict_set(&options, "probesize", cached_probesize, 0);
+            av_dict_set(&options, "analyzeduration", cached_analyzeduration, 0);
+        }
+        int ret = avformat_open_input(&format_ctx_, path.c_str(), input_format, &options);
+        av_dict_free(&options);
+        if (ret < 0) {
+            format_ctx_ = nullptr;
+            return false;
+        }
+        return true;
+    };
+
+    if (io.memory_map_local_files && is_local_file(path)) {
+        auto mapped = std::make_unique<MappedFileIO>();
+        if (mapped->open(path)) {
+            AVFormatContext* ctx = avformat_alloc_context();
+            if (!ctx) {
+                return false;
+            }
+            ctx->pb = mapped->context();
+            ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+            // avformat_open_input frees the context on failure, but never a custom pb.
+            if (open_with(ctx)) {
+                mapped_io_ = std::move(mapped);
+                utils::get_logger()->debug("Reading {} through a memory mapping", path);
+                return true;
+            }
+            utils::get_logger()->warn("Memory-mapped open failed for {}, retrying with buffered I/O", path);
+        }
+    }
+    return open_with(nullptr);
+}
+
+bool MediaSource::apply_probe_cache(const ProbeCacheEntry& cached) {
+    nlohmann::json j = nlohmann::json::parse(cached.streams, nullptr, false);
+    if (j.is_discarded() || !j.contains("streams") || !j["streams"].is_array()) {
+        return false;
+    }
+    const auto& streams = j["streams"];
+    if (streams.size() != format_ctx_->nb_streams) {
+        return false;
+    }
+    std::size_t extradata_total = 0;
+    for (unsigned int i = 0; i < format_ctx_->nb_streams; ++i) {
+        const AVCodecParameters* par = format_ctx_->streams[i]->codecpar;
+        const auto& entry = streams[i];
+        if (entry.value("codec_type", -1) != static_cast<int>(par->codec_type)) {
+            return false;
+        }
+        int codec_id = entry.value("codec_id", 0);
+        if (par->codec_id != AV_CODEC_ID_NONE && codec_id != static_cast<int>(par->codec_id)) {
+            return false;
+        }
+        extradata_total += static_cast<std::size_t>(std::max(entry.value("extradata_size", 0), 0));
+    }
+    if (extradata_total != cached.extradata.size()) {
+        return false;
+    }
+
+    std::size_t offset = 0;
+    for (unsigned int i = 0; i < format_ctx_->nb_streams; ++i) {
+        AVStream* stream = format_ctx_->streams[i];
+        const auto& entry = streams[i];
+        stream->codecpar->codec_id = static_cast<AVCodecID>(entry.value("codec_id", 0));
+        int extradata_size = std::max(entry.value("extradata_size", 0), 0);
+        apply_stream_json(stream, entry, cached.extradata.data() + offset, extradata_size);
+        offset += static_cast<std::size_t>(extradata_size);
+    }
+    if (format_ctx_->duration == AV_NOPTS_VALUE) {
+        read_field(j, "duration", format_ctx_->duration);
+    }
+    if (format_ctx_->start_time == AV_NOPTS_VALUE) {
+        read_field(j, "start_time", format_ctx_->start_time);
+    }
+    if (format_ctx_->bit_rate <= 0) {
+        read_field(j, "bit_rate", format_ctx_->bit_rate);
+    }
+    return true;
+}
+
+ProbeCacheEntry MediaSource::make_probe_cache_entry() const {
+    ProbeCacheEntry entry;
+    if (format_ctx_->iformat && format_ctx_->iformat->name) {
+        entry.format_name = format_ctx_->iformat->name;
+    }
+    nlohmann::json j;
+    j["duration"] = format_ctx_->duration;
+    j["start_time"] = format_ctx_->start_time;
+    j["bit_rate"] = format_ctx_->bit_rate;
+    j["streams"] = nlohmann::json::array();
+    for (unsigned int i = 0; i < format_ctx_->nb_streams; ++i) {
+        const AVStream* stream = format_ctx_->streams[i];
+        j["streams"].push_back(stream_to_json(stream));
+        const AVCodecParameters* par = stream->codecpar;
+        if (par->extradata && par->extradata_size > 0) {
+            entry.extradata.insert(entry.extradata.end(), par->extradata, par->extradata + par->extradata_size);
+        }
+    }
+    entry.streams = j.dump();
+    return entry;
+}
+
 double MediaSource::duration_seconds() const {
     if (!format_ctx_ || format_ctx_->duration == AV_NOPTS_VALUE) {
         return 0.0;
@@ -0,0 +1,101 @@
+#include "raha/core/PacketQueue.hpp"
+
+namespace raha::core {
+
+namespace {
+std::size_t packet_footprint(const AVPacket* packet) {
+    return packet ? static_cast<std::size_t>(packet->size) + sizeof(AVPacket) : 0;
+}
+
+} // namespace
+
+PacketQueue::PacketQueue(PacketQueueLimits limits) : limits_(limits) {}
+
+void PacketQueue::set_time_base(AVRational time_base) {
+    std::scoped_lock lock(mutex_);
+    time_base_ = time_base;
+}
+
+void PacketQueue::push(PacketPtr packet) {
+    {
+        std::scoped_lock lock(mutex_);
+        if (abort_) {
+            return;
+        }
+        bytes_ += packet_footprint(packet.get());
+        if (packet) {
+            duration_ += packet->duration;
+        }
+        queue_.push_back({std::move(packet), serial_});
+    }
+    cv_.notify_one();
+}
+
+std::optional<QueuedPacket> PacketQueue::pop(bool block) {
+    std::unique_lock lock(mutex_);
+    if (block) {
+        cv_.wait(lock, [this] { return abort_ || !queue_.empty(); });
+    }
+    if (abort_ || queue_.empty()) {
+        return std::nullopt;
+    }
+    QueuedPacket entry = std::move(queue_.front());
+    queue_.pop_front();
+    bytes_ -= packet_footprint(entry.packet.get());
+    if (entry.packet) {
+        duration_ -= entry.packet->duration;
+    }
+    return entry;
+}
+
+void PacketQueue::flush() {
+    std::scoped_lock lock(mutex_);
+    queue_.clear();
+    bytes_ = 0;
+    duration_ = 0;
+    ++serial_;
+}
+
+void PacketQueue::abort() {
+    {
+        std::scoped_lock lock(mutex_);
+        abort_ = true;
+    }
+    cv_.notify_all();
+}
+
+void PacketQueue::start() {
+    std::scoped_lock lock(mutex_);
+    abort_ = false;
+}
+
+bool PacketQueue::has_enough() const {
+    std::scoped_lock lock(mutex_);
+    if (bytes_ >= limits_.max_bytes) {
+        return true;
+    }
+    double duration = static_cast<double>(duration_) * av_q2d(time_base_);
+    return queue_.size() > limits_.min_packets && duration >= limits_.max_duration_seconds;
+}
+
+std::size_t PacketQueue::bytes() const {
+    std::scoped_lock lock(mutex_);
+    return bytes_;
+}
+
+double PacketQueue::duration_seconds() const {
+    std::scoped_lock lock(mutex_);
+    return static_cast<double>(duration_) * av_q2d(time_base_);
+}
+
+std::size_t PacketQueue::size() const {
+    std::scoped_lock lock(mutex_);
+    return queue_.size();
+}
+
+int PacketQueue::serial() const {
+    std::scoped_lock lock(mutex_);
+    return serial_;
+}
+
+} // namespace raha::core
@@ -0,0 +1,201 @@
+#include "raha/core/PixelPack.hpp"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAHA_PIXEL_PACK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace raha::core::pixel_pack {
+
+namespace {
+inline uint8_t average(uint8_t a, uint8_t b) {
+    return static_cast<uint8_t>((a + b + 1) >> 1);
+}
+
+const uint16_t* row16(const AVFrame* frame, int plane, int y) {
+    return reinterpret_cast<const uint16_t*>(frame->data[plane] + static_cast<std::ptrdiff_t>(y) * frame->linesize[plane]);
+}
+
+const uint8_t* row8(const AVFrame* frame, int plane, int y) {
+    return frame->data[plane] + static_cast<std::ptrdiff_t>(y) * frame->linesize[plane];
+}
+
+uint8_t* row8(AVFrame* frame, int plane, int y) {
+    return frame->data[plane] + static_cast<std::ptrdiff_t>(y) * frame->linesize[plane];
+}
+
+int sample_shift(const AVPixFmtDescriptor* desc) {
+    return desc->comp[0].shift + desc->comp[0].depth - 8;
+}
+
+bool little_endian_yuv(const AVPixFmtDescriptor* desc) {
+    return desc && !(desc->flags & (AV_PIX_FMT_FLAG_BE | AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))
+        && desc->nb_components >= 3 && desc->comp[0].depth >= 8 && desc->comp[0].depth <= 16;
+}
+
+} // namespace
+
+void narrow_row(const uint16_t* src, uint8_t* dst, int count, int shift) {
+    int i = 0;
+#if defined(RAHA_PIXEL_PACK_SSE2)
+    const __m128i shift_count = _mm_cvtsi32_si128(shift);
+    for (; i + 16 <= count; i += 16) {
+        __m128i lo = _mm_srl_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), shift_count);
+        __m128i hi = _mm_srl_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)), shift_count);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = static_cast<uint8_t>(std::min(src[i] >> shift, 255));
+    }
+}
+
+void average_rows(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, int count) {
+    int i = 0;
+#if defined(RAHA_PIXEL_PACK_SSE2)
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_avg_epu8(a, b));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = average(row0[i], row1[i]);
+    }
+}
+
+void downsample_2x2(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, int src_count) {
+    // Vertical pairs first, then horizontal pairs, both with rounding: the same order as
+    // two chained pavgb so that both paths agree bit for bit.
+    const int dst_count = (src_count + 1) / 2;
+    int i = 0;
+#if defined(RAHA_PIXEL_PACK_SSE2)
+    const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    for (; 2 * i + 32 <= src_count; i += 16) {
+        __m128i v0 = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * i)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * i)));
+        __m128i v1 = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * i + 16)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * i + 16)));
+        __m128i h0 = _mm_avg_epu16(_mm_and_si128(v0, low_bytes), _mm_srli_epi16(v0, 8));
+        __m128i h1 = _mm_avg_epu16(_mm_and_si128(v1, low_bytes), _mm_srli_epi16(v1, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(h0, h1));
+    }
+#endif
+    for (; i < dst_count; ++i) {
+        const int left = 2 * i;
+        const int right = std::min(left + 1, src_count - 1);
+        dst[i] = average(average(row0[left], row1[left]), average(row0[right], row1[right]));
+    }
+}
+
+bool can_pack_to_yuv420p(AVPixelFormat format) {
+    switch (format) {
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUVJ444P:
+    case AV_PIX_FMT_YUVJ440P:
+    case AV_PIX_FMT_YUVJ411P:
+        // Full range, which SDL's YUV textures would read as limited; swscale converts them.
+        return false;
+    default:
+        break;
+    }
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!little_endian_yuv(desc) || !(desc->flags & AV_PIX_FMT_FLAG_PLANAR)) {
+        return false;
+    }
+    // Fully planar only; semi-planar layouts keep both chroma components in one plane.
+    if (desc->comp[1].plane == desc->comp[2].plane || desc->log2_chroma_w > 1 || desc->log2_chroma_h > 1) {
+        return false;
+    }
+    return desc->comp[0].depth > 8 || desc->log2_chroma_w == 0 || desc->log2_chroma_h == 0;
+}
+
+bool can_pack_to_nv12(AVPixelFormat format) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    return little_endian_yuv(desc) && desc->comp[0].depth > 8 && desc->comp[1].plane == 1 && desc->comp[2].plane == 1
+        && desc->log2_chroma_w == 1 && desc->log2_chroma_h == 1;
+}
+
+bool pack_to_yuv420p(const AVFrame* src, AVFrame* dst, std::vector<uint8_t>& scratch) {
+    const auto format = static_cast<AVPixelFormat>(src->format);
+    if (!can_pack_to_yuv420p(format) || dst->format != AV_PIX_FMT_YUV420P) {
+        return false;
+    }
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    const bool wide = desc->comp[0].depth > 8;
+    const int shift = sample_shift(desc);
+
+    if (wide) {
+        for (int y = 0; y < src->height; ++y) {
+            narrow_row(row16(src, 0, y), row8(dst, 0, y), src->width, shift);
+        }
+    } else {
+        av_image_copy_plane(dst->data[0], dst->linesize[0], src->data[0], src->linesize[0], src->width, src->height);
+    }
+
+    const int chroma_width = AV_CEIL_RSHIFT(src->width, desc->log2_chroma_w);
+    const int chroma_height = AV_CEIL_RSHIFT(src->height, desc->log2_chroma_h);
+    const int dst_height = AV_CEIL_RSHIFT(src->height, 1);
+    const bool horizontal = desc->log2_chroma_w == 0;
+    const bool vertical = desc->log2_chroma_h == 0;
+    if (const std::size_t needed = wide ? static_cast<std::size_t>(chroma_width) * 2 : 0; scratch.size() < needed) {
+        scratch.resize(needed);
+    }
+
+    for (int plane = 1; plane <= 2; ++plane) {
+        const int src_plane = desc->comp[plane].plane;
+        for (int y = 0; y < dst_height; ++y) {
+            const int y0 = vertical ? std::min(2 * y, chroma_height - 1) : y;
+            const int y1 = vertical ? std::min(2 * y + 1, chroma_height - 1) : y;
+            const uint8_t* r0 = nullptr;
+            const uint8_t* r1 = nullptr;
+            if (wide) {
+                narrow_row(row16(src, src_plane, y0), scratch.data(), chroma_width, shift);
+                r0 = scratch.data();
+                r1 = r0;
+                if (y1 != y0) {
+                    narrow_row(row16(src, src_plane, y1), scratch.data() + chroma_width, chroma_width, shift);
+                    r1 = scratch.data() + chroma_width;
+                }
+            } else {
+                r0 = row8(src, src_plane, y0);
+                r1 = row8(src, src_plane, y1);
+            }
+            uint8_t* out = row8(dst, plane, y);
+            if (horizontal) {
+                downsample_2x2(r0, r1, out, chroma_width);
+            } else if (vertical) {
+                average_rows(r0, r1, out, chroma_width);
+            } else {
+                std::copy(r0, r0 + chroma_width, out);
+            }
+        }
+    }
+    return true;
+}
+
+bool pack_to_nv12(const AVFrame* src, AVFrame* dst) {
+    const auto format = static_cast<AVPixelFormat>(src->format);
+    if (!can_pack_to_nv12(format) || dst->format != AV_PIX_FMT_NV12) {
+        return false;
+    }
+    const int shift = sample_shift(av_pix_fmt_desc_get(format));
+    for (int y = 0; y < src->height; ++y) {
+        narrow_row(row16(src, 0, y), row8(dst, 0, y), src->width, shift);
+    }
+    const int chroma_samples = AV_CEIL_RSHIFT(src->width, 1) * 2;
+    for (int y = 0; y < AV_CEIL_RSHIFT(src->height, 1); ++y) {
+        narrow_row(row16(src, 1, y), row8(dst, 1, y), chroma_samples, shift);
+    }
+    return true;
+}
+
+} // namespace raha::core::pixel_pack
@@ -4,6 +4,14 @@
 
 namespace raha::core {
 
+namespace {
+// Fine steps up to 2x, then doublings to 32x; the fast end relies on trick play.
+constexpr double fine_speed_step = 0.25;
+constexpr double min_speed = 0.25;
+constexpr double doubling_from_speed = 2.0;
+constexpr double max_speed = 32.0;
+} // namespace
+
 PlaybackController::PlaybackController(MediaPlayer& player) : player_(player) {}
 
 void PlaybackController::toggle_play_pause() {
@@ -20,12 +28,14 @@ void PlaybackController::stop() {
 
 void PlaybackController::faster() {
     auto speed = player_.config().playback.playback_speed;
-    player_.set_playback_speed(std::min(speed + 0.25, 4.0));
+    speed = speed < doubling_from_speed ? std::min(speed + fine_speed_step, doubling_from_speed) : speed * 2.0;
+    player_.set_playback_speed(std::min(speed, max_speed));
 }
 
 void PlaybackController::slower() {
     auto speed = player_.config().playback.playback_speed;
-    player_.set_playback_speed(std::max(speed - 0.25, 0.25));
+    speed = speed > doubling_from_speed ? std::max(speed / 2.0, doubling_from_speed) : speed - fine_speed_step;
+    player_.set_playback_speed(std::max(speed, min_speed));
 }
 
 void PlaybackController::normal_speed() {
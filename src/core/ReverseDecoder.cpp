@@ -0,0 +1,308 @@
+#include "raha/core/ReverseDecoder.hpp"
+
+#include "raha/utils/Logger.hpp"
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+#include <algorithm>
+#include <chrono>
+
+namespace raha::core {
+
+namespace {
+// The GOP being played plus the one prefetched behind it.
+constexpr std::size_t max_buffered_gops = 2;
+
+int interrupt_requested(void* opaque) {
+    return static_cast<const std::atomic<bool>*>(opaque)->load() ? 1 : 0;
+}
+
+struct PacketFreer {
+    void operator()(AVPacket* packet) const {
+        av_packet_free(&packet);
+    }
+};
+
+int64_t frame_pts(const AVFrame* frame) {
+    return frame->pts != AV_NOPTS_VALUE ? frame->pts : frame->best_effort_timestamp;
+}
+
+} // namespace
+
+std::size_t frame_bytes(const AVFrame* frame) {
+    std::size_t bytes = 0;
+    for (const AVBufferRef* buffer : frame->buf) {
+        if (buffer) {
+            bytes += buffer->size;
+        }
+    }
+    return bytes;
+}
+
+bool ReverseGop::add(FramePtr frame, std::size_t budget) {
+    if (keyframe_only) {
+        return false;
+    }
+    const std::size_t size = frame_bytes(frame.get());
+    if (!frames.empty() && bytes + size > budget) {
+        frames.resize(1);
+        bytes = frame_bytes(frames.front().get());
+        keyframe_only = true;
+        return false;
+    }
+    bytes += size;
+    frames.push_back(std::move(frame));
+    return true;
+}
+
+void ReverseGop::finish() {
+    std::stable_sort(frames.begin(), frames.end(), [](const FramePtr& a, const FramePtr& b) { return frame_pts(a.get()) < frame_pts(b.get()); });
+}
+
+ReverseDecoder::ReverseDecoder(ReverseTuning tuning) : tuning_(tuning), memory_limit_(tuning.memory_limit) {}
+ReverseDecoder::~ReverseDecoder() { stop(); }
+
+bool ReverseDecoder::start(const std::string& path, int stream_index, double seconds, std::shared_ptr<const KeyframeIndex> index) {
+    stop();
+    // Also the demuxer's interrupt flag, so it has to be cleared before opening.
+    stop_ = false;
+    if (!open(path, stream_index)) {
+        return false;
+    }
+    index_ = index && index->stream_index() == stream_index ? std::move(index) : nullptr;
+    finished_ = false;
+    stats_ = {};
+    const int64_t end = av_rescale_q(static_cast<int64_t>(seconds * AV_TIME_BASE), AV_TIME_BASE_Q, time_base_);
+    worker_ = std::thread([this, end] { decode_loop(end); });
+    return true;
+}
+
+void ReverseDecoder::stop() {
+    if (worker_.joinable()) {
+        {
+            std::scoped_lock lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+    std::scoped_lock lock(mutex_);
+    gops_.clear();
+    stats_.buffered_bytes = 0;
+}
+
+std::optional<FramePtr> ReverseDecoder::next_frame() {
+    std::scoped_lock lock(mutex_);
+    if (gops_.empty()) {
+        return std::nullopt;
+    }
+    ReverseGop& gop = gops_.front();
+    FramePtr frame = std::move(gop.frames.back());
+    gop.frames.pop_back();
+    stats_.buffered_bytes -= std::min(stats_.buffered_bytes, frame_bytes(frame.get()));
+    if (gop.frames.empty()) {
+        gops_.pop_front();
+        cv_.notify_all();
+    }
+    return frame;
+}
+
+bool ReverseDecoder::finished() const {
+    std::scoped_lock lock(mutex_);
+    return finished_ && gops_.empty();
+}
+
+ReverseStats ReverseDecoder::stats() const {
+    std::scoped_lock lock(mutex_);
+    return stats_;
+}
+
+bool ReverseDecoder::open(const std::string& path, int stream_index) {
+    if (format_ && codec_ && path == path_ && stream_index == stream_index_) {
+        return true;
+    }
+    format_.reset();
+    codec_.reset();
+    path_.clear();
+    AVFormatContext* ctx = avformat_alloc_context();
+    if (!ctx) {
+        return false;
+    }
+    ctx->interrupt_callback.callback = &interrupt_requested;
+    ctx->interrupt_callback.opaque = &stop_;
+    if (avformat_open_input(&ctx, path.c_str(), nullptr, nullptr) < 0) {
+        return false;
+    }
+    format_.reset(ctx);
+    if (avformat_find_stream_info(ctx, nullptr) < 0 || stream_index < 0 || stream_index >= static_cast<int>(ctx->nb_streams)) {
+        format_.reset();
+        return false;
+    }
+    for (unsigned int i = 0; i < ctx->nb_streams; ++i) {
+        ctx->streams[i]->discard = static_cast<int>(i) == stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    const AVStream* stream = ctx->streams[stream_index];
+    const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    CodecContextPtr codec_ctx(codec ? avcodec_alloc_context3(codec) : nullptr);
+    if (!codec_ctx || avcodec_parameters_to_context(codec_ctx.get(), stream->codecpar) < 0) {
+        format_.reset();
+        return false;
+    }
+    codec_ctx->pkt_timebase = stream->time_base;
+    codec_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    codec_ctx->thread_count = 0;
+    if (avcodec_open2(codec_ctx.get(), codec, nullptr) < 0) {
+        format_.reset();
+        return false;
+    }
+    codec_ = std::move(codec_ctx);
+    path_ = path;
+    stream_index_ = stream_index;
+    time_base_ = stream->time_base;
+    return true;
+}
+
+void ReverseDecoder::decode_loop(int64_t end) {
+    using clock = std::chrono::steady_clock;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || gops_.size() < max_buffered_gops; });
+            if (stop_) {
+                return;
+            }
+        }
+        const auto begin = clock::now();
+        auto gop = decode_gop(end);
+        std::scoped_lock lock(mutex_);
+        if (stop_) {
+            return;
+        }
+        if (!gop) {
+            finished_ = true;
+            return;
+        }
+        end = gop->start;
+        ++stats_.gops;
+        if (gop->keyframe_only) {
+            ++stats_.keyframe_only_gops;
+        }
+        stats_.buffered_bytes += gop->bytes;
+        stats_.gop_decode_seconds = std::chrono::duration<double>(clock::now() - begin).count();
+        gops_.push_back(std::move(*gop));
+    }
+}
+
+std::optional<ReverseGop> ReverseDecoder::decode_gop(int64_t end) {
+    const AVStream* stream = format_->streams[stream_index_];
+    const int64_t first_pts = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    if (end <= first_pts) {
+        return std::nullopt;
+    }
+    int64_t target = end - 1;
+    int64_t step = av_rescale_q(1, AVRational {1, 1}, time_base_);
+    std::optional<int64_t> previous_start;
+    for (int attempt = 0; attempt < tuning_.max_seek_attempts && !stop_; ++attempt) {
+        int64_t seek_pts = target;
+        if (index_) {
+            auto entry = index_->find(target);
+            if (!entry || entry->pts >= end) {
+                return std::nullopt;
+            }
+            seek_pts = entry->pts;
+        }
+        if (av_seek_frame(format_.get(), stream_index_, seek_pts, AVSEEK_FLAG_BACKWARD) < 0) {
+            return std::nullopt;
+        }
+        avcodec_flush_buffers(codec_.get());
+        auto gop = decode_from_keyframe(end);
+        if (!gop || !gop->frames.empty()) {
+            return gop;
+        }
+        // The demuxer found no keyframe before `end` near the target: either a sparse
+        // container index or the start of the stream.
+        if (previous_start == gop->start || target <= first_pts) {
+            return std::nullopt;
+        }
+        previous_start = gop->start;
+        target = std::max(first_pts, target - step);
+        step *= 2;
+    }
+    return std::nullopt;
+}
+
+std::optional<ReverseGop> ReverseDecoder::decode_from_keyframe(int64_t end) {
+    std::unique_ptr<AVPacket, PacketFreer> packet(av_packet_alloc());
+    AVCodecContext* ctx = codec_.get();
+    if (!packet) {
+        return std::nullopt;
+    }
+    ReverseGop gop;
+    const std::size_t budget = memory_limit_ / max_buffered_gops;
+    const bool keyframes_only = keyframes_only_;
+    bool started = false;
+    bool draining = false;
+    while (!stop_) {
+        if (!draining) {
+            const int ret = av_read_frame(format_.get(), packet.get());
+            if (ret < 0) {
+                draining = true;
+            } else if (packet->stream_index != stream_index_) {
+                av_packet_unref(packet.get());
+                continue;
+            } else {
+                const int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+                const int64_t dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : pts;
+                const bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+                if (!started) {
+                    if (!key) {
+                        av_packet_unref(packet.get());
+                        continue;
+                    }
+                    started = true;
+                    gop.start = pts;
+                    if (pts >= end) {
+                        return gop;
+                    }
+                } else if (keyframes_only || dts >= end) {
+                    // Decode order never goes back below the dts, so no later packet shows
+                    // anything before `end`.
+                    draining = true;
+                }
+            }
+        }
+        const int sent = avcodec_send_packet(ctx, draining ? nullptr : packet.get());
+        av_packet_unref(packet.get());
+        if (sent < 0 && sent != AVERROR(EAGAIN) && sent != AVERROR_EOF) {
+            utils::get_logger()->warn("Reverse decoder rejected a packet: {}", sent);
+        }
+        while (true) {
+            FramePtr frame(av_frame_alloc());
+            if (!frame) {
+                return std::nullopt;
+            }
+            const int received = avcodec_receive_frame(ctx, frame.get());
+            if (received == AVERROR_EOF) {
+                gop.finish();
+                return gop;
+            }
+            if (received < 0) {
+                break;
+            }
+            // Leading pictures of an open GOP belong to the GOP before.
+            const int64_t pts = frame_pts(frame.get());
+            if (pts == AV_NOPTS_VALUE || pts < gop.start || pts >= end) {
+                continue;
+            }
+            frame->pts = pts;
+            if (!gop.add(std::move(frame), budget)) {
+                return gop;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace raha::core
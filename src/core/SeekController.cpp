@@ -5,6 +5,7 @@ extern "C" {
 }
 
 #include <algorithm>
+#include <cstddef>
 
 namespace raha::core {
 
@@ -16,10 +17,42 @@ bool SeekController::seek_relative(double delta_seconds) {
 }
 
 bool SeekController::seek_absolute(double seconds) {
-    return player_.seek(seconds);
+    return seek_to(seconds, player_.config().playback.exact_seek);
+}
+
+bool SeekController::seek_to(double seconds, bool exact) {
+    return player_.seek(seconds, indexed_position(seconds), exact);
+}
+
+std::optional<int64_t> SeekController::indexed_position(double seconds) const {
+    auto index = player_.keyframe_index();
+    const AVFormatContext* format = player_.source().raw();
+    if (!index || index->empty() || !format || (format->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+        return std::nullopt;
+    }
+    // Containers with a usable index of their own (MP4, MKV with cues) seek precisely by
+    // timestamp; the byte position only helps where that index is sparse or missing.
+    const AVStream* stream = format->streams[index->stream_index()];
+    if (static_cast<std::size_t>(avformat_index_get_entries_count(stream)) * 2 >= index->size()) {
+        return std::nullopt;
+    }
+    int64_t target = av_rescale_q(static_cast<int64_t>(seconds * AV_TIME_BASE), AV_TIME_BASE_Q, index->time_base());
+    auto entry = index->find(target);
+    if (!entry) {
+        return std::nullopt;
+    }
+    return entry->pos;
 }
 
 bool SeekController::frame_step(int direction) {
+    if (direction < 0) {
+        // Seeking back one frame duration only reaches the right frame when its keyframe is
+        // close; the reverse decoder decodes the whole GOP instead.
+        return player_.step_back();
+    }
+    if (player_.reversing()) {
+        player_.set_reverse(false);
+    }
     auto meta_stream = player_.source().video_stream_index();
     if (!meta_stream) {
         return false;
@@ -31,7 +64,9 @@ bool SeekController::frame_step(int direction) {
     } else {
         frame_duration = 1.0 / frame_duration;
     }
-    return seek_relative(direction * frame_duration);
+    // Stepping is only useful when it lands on the neighbouring frame, not its keyframe.
+    double target = std::clamp(player_.current_time() + frame_duration, 0.0, player_.duration());
+    return seek_to(target, true);
 }
 
 } // namespace raha::core
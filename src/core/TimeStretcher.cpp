@@ -0,0 +1,255 @@
+#include "raha/core/TimeStretcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+
+namespace raha::core {
+
+namespace {
+// The coarse WSOLA pass tries every fourth offset on every second sample; the best one
+// is then refined at full resolution.
+constexpr int64_t coarse_offset_step = 4;
+constexpr std::size_t coarse_sample_step = 2;
+
+double correlation(const float* target, const float* candidate, std::size_t count, std::size_t stride) {
+    double dot = 0.0;
+    double energy = 0.0;
+    for (std::size_t i = 0; i < count; i += stride) {
+        dot += static_cast<double>(target[i]) * candidate[i];
+        energy += static_cast<double>(candidate[i]) * candidate[i];
+    }
+    return dot / std::sqrt(energy + 1e-9);
+}
+
+} // namespace
+
+const char* to_string(StretchAlgorithm algorithm) {
+    switch (algorithm) {
+    case StretchAlgorithm::Wsola:
+        return "wsola";
+    case StretchAlgorithm::Ola:
+        return "ola";
+    case StretchAlgorithm::Bypass:
+        break;
+    }
+    return "bypass";
+}
+
+TimeStretcher::TimeStretcher(TimeStretchTuning tuning) : tuning_(tuning) {
+    configure(sample_rate_, channels_);
+}
+
+StretchAlgorithm TimeStretcher::algorithm_for(double speed, double cheap_above_speed) {
+    if (speed == 1.0) {
+        return StretchAlgorithm::Bypass;
+    }
+    return speed > cheap_above_speed ? StretchAlgorithm::Ola : StretchAlgorithm::Wsola;
+}
+
+void TimeStretcher::configure(int sample_rate, int channels) {
+    sample_rate_ = std::max(sample_rate, 1);
+    channels_ = std::max(channels, 1);
+    hop_ = std::max<std::size_t>(64, static_cast<std::size_t>(sample_rate_ * tuning_.hop_seconds));
+    search_ = static_cast<int64_t>(sample_rate_ * tuning_.search_seconds);
+    // Rising half of a periodic Hann window; the falling half is 1 - window_, so two
+    // windows half a window apart always sum to one.
+    window_.resize(hop_);
+    for (std::size_t i = 0; i < hop_; ++i) {
+        const double s = std::sin(std::numbers::pi * static_cast<double>(i) / (2.0 * static_cast<double>(hop_)));
+        window_[i] = static_cast<float>(s * s);
+    }
+    overlap_.assign(hop_ * channels_, 0.0F);
+    reset();
+}
+
+void TimeStretcher::set_speed(double speed) {
+    speed_ = speed > 0.0 ? speed : 1.0;
+}
+
+void TimeStretcher::reset() {
+    input_.clear();
+    input_base_ = 0;
+    received_ = 0;
+    nominal_ = 0.0;
+    previous_ = 0;
+    active_ = false;
+    started_ = false;
+}
+
+StretchAlgorithm TimeStretcher::algorithm() const {
+    return algorithm_for(speed_, tuning_.cheap_above_speed);
+}
+
+TimeStretchStats TimeStretcher::stats() const {
+    TimeStretchStats stats;
+    stats.algorithm = algorithm();
+    stats.cpu_seconds = cpu_seconds_;
+    stats.output_seconds = output_seconds_;
+    return stats;
+}
+
+double TimeStretcher::buffered_frames() const {
+    if (!active_) {
+        return 0.0;
+    }
+    if (!started_) {
+        return static_cast<double>(received_) - nominal_;
+    }
+    // The next output hop fades from the last window's tail into the next window.
+    return static_cast<double>(received_) - (static_cast<double>(previous_ + static_cast<int64_t>(hop_)) + nominal_) / 2.0;
+}
+
+std::size_t TimeStretcher::process(const float* input, std::size_t frames, std::vector<float>& output) {
+    output.clear();
+    const std::size_t samples = frames * channels_;
+    if (!active_) {
+        if (speed_ == 1.0) {
+            output.assign(input, input + samples);
+            received_ += static_cast<int64_t>(frames);
+            return frames;
+        }
+        active_ = true;
+        started_ = false;
+        input_.clear();
+        input_base_ = received_;
+        nominal_ = static_cast<double>(received_);
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    input_.insert(input_.end(), input, input + samples);
+    received_ += static_cast<int64_t>(frames);
+    if (speed_ == 1.0) {
+        finish(output);
+    } else {
+        if (!started_) {
+            start();
+        }
+        while (started_ && step(output)) {
+        }
+        trim();
+    }
+    cpu_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return output.size() / channels_;
+}
+
+void TimeStretcher::start() {
+    const auto position = static_cast<int64_t>(nominal_);
+    if (position + static_cast<int64_t>(hop_) > received_) {
+        return;
+    }
+    // Pretend a window ended here, so the first real one continues the input seamlessly.
+    const float* frame = frame_at(position);
+    for (std::size_t i = 0; i < hop_; ++i) {
+        const float fall = 1.0F - window_[i];
+        for (int c = 0; c < channels_; ++c) {
+            overlap_[i * channels_ + c] = frame[i * channels_ + c] * fall;
+        }
+    }
+    previous_ = position - static_cast<int64_t>(hop_);
+    started_ = true;
+}
+
+void TimeStretcher::finish(std::vector<float>& output) {
+    // The tail of the last window plus the rising half of its natural continuation is
+    // just the input from there on, so playback resumes at 1.0x without a seam.
+    const int64_t from = started_ ? previous_ + static_cast<int64_t>(hop_) : static_cast<int64_t>(nominal_);
+    if (from < received_) {
+        const float* begin = frame_at(from);
+        output.insert(output.end(), begin, begin + (received_ - from) * channels_);
+    }
+    output_seconds_ += static_cast<double>(output.size() / channels_) / sample_rate_;
+    active_ = false;
+    started_ = false;
+    input_.clear();
+    input_base_ = received_;
+}
+
+bool TimeStretcher::step(std::vector<float>& output) {
+    const bool search = algorithm() == StretchAlgorithm::Wsola;
+    const auto nominal = static_cast<int64_t>(std::llround(nominal_));
+    if (nominal + (search ? search_ : 0) + static_cast<int64_t>(2 * hop_) > received_) {
+        return false;
+    }
+    const int64_t position = search ? best_offset(nominal) : nominal;
+    const float* frame = frame_at(position);
+    const std::size_t offset = output.size();
+    output.resize(offset + hop_ * channels_);
+    float* out = output.data() + offset;
+    for (std::size_t i = 0; i < hop_; ++i) {
+        const float rise = window_[i];
+        for (int c = 0; c < channels_; ++c) {
+            const std::size_t k = i * channels_ + c;
+            out[k] = overlap_[k] + frame[k] * rise;
+            overlap_[k] = frame[hop_ * channels_ + k] * (1.0F - rise);
+        }
+    }
+    previous_ = position;
+    nominal_ += static_cast<double>(hop_) * speed_;
+    output_seconds_ += static_cast<double>(hop_) / sample_rate_;
+    return true;
+}
+
+int64_t TimeStretcher::best_offset(int64_t nominal) {
+    const int64_t low = std::max(nominal - search_, input_base_);
+    const int64_t high = nominal + search_;
+    // Candidates are compared on a mono mix against the input that would naturally
+    // follow the last window.
+    const std::size_t span = static_cast<std::size_t>(high - low) + hop_;
+    mono_.resize(span + hop_);
+    const int64_t target_start = previous_ + static_cast<int64_t>(hop_);
+    auto mix = [this](const float* frame, float* out, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            float sum = 0.0F;
+            for (int c = 0; c < channels_; ++c) {
+                sum += frame[i * channels_ + c];
+            }
+            out[i] = sum;
+        }
+    };
+    mix(frame_at(target_start), mono_.data(), hop_);
+    float* candidates = mono_.data() + hop_;
+    mix(frame_at(low), candidates, span);
+
+    auto score = [&](int64_t position, std::size_t stride) {
+        return correlation(mono_.data(), candidates + (position - low), hop_, stride);
+    };
+    int64_t best = std::clamp(nominal, low, high);
+    double best_score = score(best, coarse_sample_step);
+    for (int64_t position = low; position <= high; position += coarse_offset_step) {
+        const double value = score(position, coarse_sample_step);
+        if (value > best_score) {
+            best_score = value;
+            best = position;
+        }
+    }
+    const int64_t coarse = best;
+    best_score = score(coarse, 1);
+    for (int64_t position = std::max(low, coarse - coarse_offset_step + 1); position <= std::min(high, coarse + coarse_offset_step - 1); ++position) {
+        const double value = score(position, 1);
+        if (value > best_score) {
+            best_score = value;
+            best = position;
+        }
+    }
+    return best;
+}
+
+const float* TimeStretcher::frame_at(int64_t position) const {
+    return input_.data() + static_cast<std::size_t>(position - input_base_) * channels_;
+}
+
+void TimeStretcher::trim() {
+    int64_t keep = static_cast<int64_t>(nominal_) - search_;
+    if (started_) {
+        keep = std::min(keep, previous_ + static_cast<int64_t>(hop_));
+    }
+    if (keep <= input_base_) {
+        return;
+    }
+    input_.erase(input_.begin(), input_.begin() + static_cast<std::ptrdiff_t>((keep - input_base_) * channels_));
+    input_base_ = keep;
+}
+
+} // namespace raha::core
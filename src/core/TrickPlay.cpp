@@ -0,0 +1,45 @@
+#include "raha/core/TrickPlay.hpp"
+
+#include <algorithm>
+
+namespace raha::core {
+
+TrickPlay::TrickPlay(TrickPlayTuning tuning) : tuning_(tuning) {}
+
+bool TrickPlay::engaged(double speed) const {
+    return speed > std::min(threshold_, tuning_.max_decoded_speed);
+}
+
+void TrickPlay::reset(double clock_time) {
+    reference_ = clock_time;
+    lag_ = 0.0;
+    last_skip_ = -std::numeric_limits<double>::infinity();
+}
+
+void TrickPlay::frame_shown(double pts) {
+    reference_ = std::max(reference_, pts);
+}
+
+std::optional<double> TrickPlay::skip_target(double clock_time, double speed, double now) {
+    lag_ = clock_time - reference_;
+    if (lag_ <= tuning_.lag_seconds * speed || now - last_skip_ < tuning_.min_skip_interval) {
+        return std::nullopt;
+    }
+    last_skip_ = now;
+    ++skips_;
+    const double target = clock_time + tuning_.lead_seconds * speed;
+    // The picture is measured from the target on, so a skip that lands on an older
+    // keyframe is not followed straight away by another.
+    reference_ = target;
+    return target;
+}
+
+TrickPlayStats TrickPlay::stats() const {
+    TrickPlayStats stats;
+    stats.active = active_;
+    stats.skips = skips_;
+    stats.lag = active_ ? std::max(lag_, 0.0) : 0.0;
+    return stats;
+}
+
+} // namespace raha::core
@@ -1,19 +1,31 @@
 #include "raha/core/VideoRenderer.hpp"
 
+#include "raha/core/PixelPack.hpp"
 #include "raha/core/ScreenshotExporter.hpp"
 #include "raha/utils/Logger.hpp"
 
 extern "C" {
 #include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 }
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
 #include <cmath>
 #include <stdexcept>
 #include <string>
 
 namespace raha::core {
 
+namespace {
+constexpr double conversion_average_weight = 0.1;
+
+} // namespace
+
 VideoRenderer::VideoRenderer() = default;
 VideoRenderer::~VideoRenderer() { shutdown(); }
 
@@ -23,15 +35,17 @@ bool VideoRenderer::initialize(SDL_Window* window, SDL_Renderer* renderer) {
     if (!window_ || !renderer_) {
         throw std::runtime_error("VideoRenderer requires valid SDL window and renderer");
     }
+    SDL_GetRendererOutputSize(renderer_, &output_width_, &output_height_);
     utils::get_logger()->info("Video renderer initialised (SDL texture pipeline)");
     return true;
 }
 
+void VideoRenderer::configure(const RenderSettings& settings) {
+    settings_ = settings;
+}
+
 void VideoRenderer::shutdown() {
-    if (texture_) {
-        SDL_DestroyTexture(texture_);
-        texture_ = nullptr;
-    }
+    release_textures();
     if (sws_) {
         sws_freeContext(sws_);
         sws_ = nullptr;
@@ -40,39 +54,140 @@ void VideoRenderer::shutdown() {
     renderer_ = nullptr;
     texture_width_ = 0;
     texture_height_ = 0;
-    pixel_buffer_.clear();
-    has_frame_ = false;
+    frame_width_ = 0;
+    frame_height_ = 0;
+    src_format_ = AV_PIX_FMT_NONE;
+    sws_threads_ = 0;
+    adjusting_ = false;
+    converted_.reset();
+    texture_view_.reset();
+    pack_scratch_ = {};
+    conversion_stats_ = {};
     pending_screenshot_.reset();
 }
 
-void VideoRenderer::render_frame(const AVFrame* frame, const VideoAdjustments& adjustments) {
+void VideoRenderer::render_frame(const AVFrame* frame, const VideoAdjustments& adjustments, std::optional<double> pts) {
     if (!frame || !renderer_) {
         return;
     }
     apply_adjustments(adjustments);
 
-    ensure_texture(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format));
+    ensure_texture(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format), full_range(frame));
+    TextureSlot& slot = slots_[static_cast<std::size_t>(acquire_slot())];
+    slot.ready = false;
+    if (!slot.texture) {
+        slot.texture = SDL_CreateTexture(renderer_, texture_format_, SDL_TEXTUREACCESS_STREAMING, texture_width_, texture_height_);
+        if (!slot.texture) {
+            throw std::runtime_error(std::string("Failed to create SDL texture: ") + SDL_GetError());
+        }
+    }
+    texture_ = slot.texture;
 
-    if (use_yuv_texture_) {
+    auto start = std::chrono::steady_clock::now();
+    switch (upload_path_) {
+    case UploadPath::Planar:
+        if (adjusting_) {
+            if (!upload_adjusted(frame)) {
+                return;
+            }
+            record_conversion(start);
+            break;
+        }
         SDL_UpdateYUVTexture(texture_, nullptr,
             frame->data[0], frame->linesize[0],
             frame->data[1], frame->linesize[1],
             frame->data[2], frame->linesize[2]);
-    } else {
-        uint8_t* dest_slices[4] {pixel_buffer_.data(), nullptr, nullptr, nullptr};
-        int dest_linesize[4] {texture_width_ * 4, 0, 0, 0};
-
-        const uint8_t* src_data[4];
-        int src_linesize[4];
-        for (int i = 0; i < 4; ++i) {
-            src_data[i] = frame->data[i];
-            src_linesize[i] = frame->linesize[i];
+        break;
+    case UploadPath::SemiPlanar:
+        if (adjusting_) {
+            if (!upload_adjusted(frame)) {
+                return;
+            }
+            record_conversion(start);
+            break;
         }
-
-        sws_scale(sws_, src_data, src_linesize, 0, frame->height, dest_slices, dest_linesize);
-        SDL_UpdateTexture(texture_, nullptr, pixel_buffer_.data(), texture_width_ * 4);
+        SDL_UpdateNVTexture(texture_, nullptr, frame->data[0], frame->linesize[0], frame->data[1], frame->linesize[1]);
+        break;
+    case UploadPath::PackPlanar:
+    case UploadPath::PackSemiPlanar: {
+        const bool planar = upload_path_ == UploadPath::PackPlanar;
+        auto pack = [&](AVFrame* dst) {
+            return planar ? pixel_pack::pack_to_yuv420p(frame, dst, pack_scratch_) : pixel_pack::pack_to_nv12(frame, dst);
+        };
+        if (adjusting_) {
+            // The adjusted texture is BGRA, so packing still needs a staging frame.
+            if (!pack(converted_.get())) {
+                return;
+            }
+            converted_->colorspace = frame->colorspace;
+            converted_->color_range = frame->color_range;
+            if (!upload_adjusted(converted_.get())) {
+                return;
+            }
+        } else {
+            if (!lock_texture(planar ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_NV12)) {
+                return;
+            }
+            bool packed = pack(texture_view_.get());
+            unlock_texture();
+            if (!packed) {
+                return;
+            }
+        }
+        record_conversion(start);
+        break;
+    }
+    case UploadPath::Scale: {
+        int ret = 0;
+        apply_scaler_colorspace(frame);
+        if (adjusting_) {
+            ret = sws_scale_frame(sws_, converted_.get(), frame);
+            if (ret >= 0 && !upload_adjusted(converted_.get())) {
+                return;
+            }
+        } else {
+            if (!lock_texture(scale_format_)) {
+                return;
+            }
+            ret = sws_scale_frame(sws_, texture_view_.get(), frame);
+            unlock_texture();
+        }
+        if (ret < 0) {
+            utils::get_logger()->warn("Frame downscale failed: {}", ret);
+            return;
+        }
+        record_conversion(start);
+        break;
+    }
+    case UploadPath::Convert: {
+        // sws_scale_frame spreads the slices over the context's own thread pool and writes
+        // straight into the locked texture. Adjusted frames are converted to 4:2:0 for
+        // ColorConverter instead, so their chroma is subsampled only while adjusting.
+        apply_scaler_colorspace(frame);
+        int ret = 0;
+        if (adjusting_) {
+            ret = sws_scale_frame(sws_, converted_.get(), frame);
+            if (ret >= 0 && !upload_adjusted(converted_.get())) {
+                return;
+            }
+        } else {
+            if (!lock_texture(AV_PIX_FMT_BGRA)) {
+                return;
+            }
+            ret = sws_scale_frame(sws_, texture_view_.get(), frame);
+            unlock_texture();
+        }
+        if (ret < 0) {
+            utils::get_logger()->warn("Pixel format conversion failed: {}", ret);
+            return;
+        }
+        record_conversion(start);
+        break;
+    }
     }
-    has_frame_ = true;
+    slot.pts = pts.value_or(std::numeric_limits<double>::lowest());
+    slot.sequence = ++next_sequence_;
+    slot.ready = true;
 
     if (pending_screenshot_) {
         ScreenshotExporter exporter;
@@ -85,17 +200,105 @@ void VideoRenderer::render_frame(const AVFrame* frame, const VideoAdjustments& a
     }
 }
 
-void VideoRenderer::present() {
-    if (!renderer_ || !texture_ || !has_frame_) {
-        return;
+bool VideoRenderer::can_prepare() const {
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        if (static_cast<int>(i) != displayed_ && !slots_[i].ready) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<double> VideoRenderer::next_prepared_pts() const {
+    std::optional<double> earliest;
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        if (static_cast<int>(i) != displayed_ && slots_[i].ready && (!earliest || slots_[i].pts < *earliest)) {
+            earliest = slots_[i].pts;
+        }
+    }
+    return earliest;
+}
+
+std::optional<double> VideoRenderer::displayed_pts() const {
+    if (displayed_ < 0 || slots_[static_cast<std::size_t>(displayed_)].pts == std::numeric_limits<double>::lowest()) {
+        return std::nullopt;
+    }
+    return slots_[static_cast<std::size_t>(displayed_)].pts;
+}
+
+void VideoRenderer::flush() {
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        if (static_cast<int>(i) != displayed_) {
+            slots_[i].ready = false;
+        }
+    }
+}
+
+int VideoRenderer::acquire_slot() const {
+    int earliest = -1;
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        const int index = static_cast<int>(i);
+        if (index == displayed_) {
+            continue;
+        }
+        if (!slots_[i].ready) {
+            return index;
+        }
+        if (earliest < 0 || shown_before(slots_[i], slots_[static_cast<std::size_t>(earliest)])) {
+            earliest = index;
+        }
+    }
+    // Every spare texture holds a prepared frame; the earliest is the one a newer frame
+    // supersedes.
+    return earliest;
+}
+
+void VideoRenderer::release_textures() {
+    for (auto& slot : slots_) {
+        if (slot.texture) {
+            SDL_DestroyTexture(slot.texture);
+        }
+        slot = {};
+    }
+    texture_ = nullptr;
+    displayed_ = -1;
+}
+
+bool VideoRenderer::present(double display_time) {
+    if (!renderer_) {
+        return false;
+    }
+    int next = -1;
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        const TextureSlot& slot = slots_[i];
+        if (static_cast<int>(i) != displayed_ && slot.ready && slot.pts <= display_time
+            && (next < 0 || shown_before(slots_[static_cast<std::size_t>(next)], slot))) {
+            next = static_cast<int>(i);
+        }
     }
-    SDL_Rect dest {0, 0, texture_width_, texture_height_};
+    if (next >= 0) {
+        // Prepared frames older than the one shown now were never due at a vsync.
+        const TextureSlot& shown = slots_[static_cast<std::size_t>(next)];
+        for (auto& slot : slots_) {
+            if (slot.ready && shown_before(slot, shown)) {
+                slot.ready = false;
+            }
+        }
+        if (displayed_ >= 0) {
+            slots_[static_cast<std::size_t>(displayed_)].ready = false;
+        }
+        displayed_ = next;
+    }
+    if (displayed_ < 0) {
+        return false;
+    }
+    SDL_Rect dest {0, 0, frame_width_, frame_height_};
     int window_w = 0;
     int window_h = 0;
     SDL_GetRendererOutputSize(renderer_, &window_w, &window_h);
     if (window_w > 0 && window_h > 0) {
         double window_ratio = static_cast<double>(window_w) / static_cast<double>(window_h);
-        double video_ratio = static_cast<double>(texture_width_) / static_cast<double>(texture_height_);
+        double video_ratio = static_cast<double>(frame_width_) / static_cast<double>(frame_height_);
         if (std::abs(window_ratio - video_ratio) > 0.01) {
             if (window_ratio > video_ratio) {
                 dest.h = window_h;
@@ -112,13 +315,18 @@ void VideoRenderer::present() {
             dest = SDL_Rect {0, 0, window_w, window_h};
         }
     }
-    SDL_RenderCopy(renderer_, texture_, nullptr, &dest);
+    SDL_RenderCopy(renderer_, slots_[static_cast<std::size_t>(displayed_)].texture, nullptr, &dest);
+    return next >= 0;
 }
 
 void VideoRenderer::resize(int width, int height) {
-    utils::get_logger()->info("Resize requested: {}x{}", width, height);
-    (void)width;
-    (void)height;
+    if (width == output_width_ && height == output_height_) {
+        return;
+    }
+    utils::get_logger()->debug("Video output resized to {}x{}", width, height);
+    output_width_ = width;
+    output_height_ = height;
+    resized_at_ = std::chrono::steady_clock::now();
 }
 
 void VideoRenderer::request_screenshot(const std::filesystem::path& path) {
@@ -126,49 +334,289 @@ void VideoRenderer::request_screenshot(const std::filesystem::path& path) {
 }
 
 void VideoRenderer::apply_adjustments(const VideoAdjustments& adjustments) {
-    (void)adjustments;
-    // TODO: Integrate shader-based tone mapping and post-processing.
+    adjustments_ = adjustments;
+}
+
+bool VideoRenderer::lock_texture(AVPixelFormat format) {
+    void* pixels = nullptr;
+    int pitch = 0;
+    if (SDL_LockTexture(texture_, nullptr, &pixels, &pitch) != 0) {
+        utils::get_logger()->warn("Failed to lock video texture: {}", SDL_GetError());
+        return false;
+    }
+    if (!texture_view_) {
+        texture_view_ = FramePtr(av_frame_alloc());
+        if (!texture_view_) {
+            SDL_UnlockTexture(texture_);
+            throw std::runtime_error("Failed to allocate texture frame");
+        }
+    }
+    // Plane layout of SDL's locked streaming textures: chroma follows luma, with half the
+    // pitch for IYUV and the full pitch for interleaved NV12.
+    AVFrame* view = texture_view_.get();
+    auto* base = static_cast<uint8_t*>(pixels);
+    const std::ptrdiff_t luma_size = static_cast<std::ptrdiff_t>(pitch) * texture_height_;
+    view->format = format;
+    view->width = texture_width_;
+    view->height = texture_height_;
+    view->data[0] = base;
+    view->linesize[0] = pitch;
+    std::size_t size = static_cast<std::size_t>(luma_size);
+    if (format == AV_PIX_FMT_YUV420P) {
+        const int chroma_pitch = (pitch + 1) / 2;
+        const std::ptrdiff_t chroma_size = static_cast<std::ptrdiff_t>(chroma_pitch) * ((texture_height_ + 1) / 2);
+        view->data[1] = base + luma_size;
+        view->data[2] = base + luma_size + chroma_size;
+        view->linesize[1] = chroma_pitch;
+        view->linesize[2] = chroma_pitch;
+        size += static_cast<std::size_t>(2 * chroma_size);
+    } else if (format == AV_PIX_FMT_NV12) {
+        view->data[1] = base + luma_size;
+        view->linesize[1] = pitch;
+        size += static_cast<std::size_t>(pitch) * static_cast<std::size_t>((texture_height_ + 1) / 2);
+    }
+    // swscale's frame API only writes into reference-counted destinations; the texture
+    // memory is borrowed, so the buffer does not free it.
+    view->buf[0] = av_buffer_create(base, size, [](void*, uint8_t*) {}, nullptr, 0);
+    if (!view->buf[0]) {
+        unlock_texture();
+        return false;
+    }
+    return true;
+}
+
+void VideoRenderer::unlock_texture() {
+    av_frame_unref(texture_view_.get());
+    SDL_UnlockTexture(texture_);
+}
+
+bool VideoRenderer::upload_adjusted(const AVFrame* source) {
+    // A staged frame may be downscaled, so the fallback goes by the decoded height.
+    const AVColorSpace colorspace = resolve_colorspace(source->colorspace, frame_height_);
+    color_converter_.configure(adjustments_, colorspace, full_range(source) ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG);
+
+    if (!lock_texture(AV_PIX_FMT_BGRA)) {
+        return false;
+    }
+    bool converted = color_converter_.convert(source, texture_view_->data[0], texture_view_->linesize[0]);
+    unlock_texture();
+    return converted;
 }
 
-void VideoRenderer::ensure_texture(int width, int height, AVPixelFormat format) {
+void VideoRenderer::ensure_texture(int width, int height, AVPixelFormat format, bool full_range_source) {
     if (!renderer_) {
         return;
     }
-    bool format_changed = (format != src_format_);
-    if (width != texture_width_ || height != texture_height_ || format_changed) {
-        texture_width_ = width;
-        texture_height_ = height;
+    const bool source_changed = width != frame_width_ || height != frame_height_ || format != src_format_;
+    // Window drags produce a stream of sizes; only a size that has been stable for the
+    // cool-down (or a new source) reallocates the texture.
+    const bool resize_settled = std::chrono::steady_clock::now() - resized_at_ >= std::chrono::milliseconds(settings_.resize_cooldown_ms);
+    if (source_changed || resize_settled) {
+        applied_output_width_ = output_width_;
+        applied_output_height_ = output_height_;
+    }
+    auto [target_width, target_height] = target_size(width, height);
+    const bool adjust = adjustments_active(adjustments_);
+    UploadPath base_path = choose_upload_path(format);
+    if (full_range_source && !adjust && (base_path == UploadPath::PackPlanar || base_path == UploadPath::PackSemiPlanar)) {
+        // Packing keeps the range, but SDL reads YUV textures as limited range; swscale
+        // expands it into BGRA instead. ColorConverter handles it while adjusting.
+        base_path = UploadPath::Convert;
+    }
+    const bool scaling = target_width != width || target_height != height;
+    const UploadPath path = scaling ? UploadPath::Scale : base_path;
+    if (source_changed || target_width != texture_width_ || target_height != texture_height_ || path != upload_path_ || adjust != adjusting_) {
+        frame_width_ = width;
+        frame_height_ = height;
+        texture_width_ = target_width;
+        texture_height_ = target_height;
         src_format_ = format;
-        if (texture_) {
-            SDL_DestroyTexture(texture_);
-            texture_ = nullptr;
-        }
-
-        bool can_use_yuv = (format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUVJ420P);
-        use_yuv_texture_ = can_use_yuv;
-        if (use_yuv_texture_) {
-            pixel_buffer_.clear();
-            if (sws_) {
-                sws_freeContext(sws_);
-                sws_ = nullptr;
+        // Prepared frames no longer match the new layout, so the whole ring starts over.
+        release_textures();
+
+        upload_path_ = path;
+        adjusting_ = adjust;
+        if (sws_) {
+            sws_freeContext(sws_);
+            sws_ = nullptr;
+        }
+        converted_.reset();
+        conversion_stats_ = {};
+        Uint32 texture_format = SDL_PIXELFORMAT_IYUV;
+        switch (base_path) {
+        case UploadPath::Planar:
+        case UploadPath::PackPlanar:
+            scale_format_ = AV_PIX_FMT_YUV420P;
+            break;
+        case UploadPath::SemiPlanar:
+            texture_format = format == AV_PIX_FMT_NV21 && !scaling ? SDL_PIXELFORMAT_NV21 : SDL_PIXELFORMAT_NV12;
+            scale_format_ = AV_PIX_FMT_NV12;
+            break;
+        case UploadPath::PackSemiPlanar:
+            texture_format = SDL_PIXELFORMAT_NV12;
+            scale_format_ = AV_PIX_FMT_NV12;
+            break;
+        case UploadPath::Scale:
+        case UploadPath::Convert:
+            texture_format = SDL_PIXELFORMAT_BGRA32;
+            scale_format_ = AV_PIX_FMT_BGRA;
+            break;
+        }
+        if (adjusting_) {
+            texture_format = SDL_PIXELFORMAT_BGRA32;
+            // Scaled, converted or packed 4:2:0 is staged here for ColorConverter.
+            if (scaling || base_path == UploadPath::Convert) {
+                scale_format_ = AV_PIX_FMT_YUV420P;
+                allocate_converted(target_width, target_height, AV_PIX_FMT_YUV420P);
+            } else if (base_path == UploadPath::PackPlanar || base_path == UploadPath::PackSemiPlanar) {
+                allocate_converted(width, height, base_path == UploadPath::PackPlanar ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_NV12);
             }
-            texture_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, width, height);
-        } else {
-            pixel_buffer_.resize(static_cast<std::size_t>(width) * height * 4);
-            texture_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_BGRA32, SDL_TEXTUREACCESS_STREAMING, width, height);
         }
-
-        if (!texture_) {
-            throw std::runtime_error(std::string("Failed to create SDL texture: ") + SDL_GetError());
+        texture_format_ = texture_format;
+        if (scaling) {
+            utils::get_logger()->debug("Downscaling {}x{} to {}x{} before upload", width, height, target_width, target_height);
         }
     }
 
-    if (!use_yuv_texture_) {
-        sws_ = sws_getCachedContext(sws_, width, height, format, width, height, AV_PIX_FMT_BGRA, SWS_BILINEAR, nullptr, nullptr, nullptr);
-        if (!sws_) {
-            throw std::runtime_error("Failed to acquire swscale context");
+    if (upload_path_ == UploadPath::Scale || upload_path_ == UploadPath::Convert) {
+        ensure_scaler(width, height, format);
+    }
+}
+
+std::pair<int, int> VideoRenderer::target_size(int width, int height) const {
+    if (!settings_.downscale_to_output || applied_output_width_ <= 0 || applied_output_height_ <= 0 || width <= 0 || height <= 0) {
+        return {width, height};
+    }
+    const double scale = std::min(static_cast<double>(applied_output_width_) / width, static_cast<double>(applied_output_height_) / height);
+    if (scale >= 1.0) {
+        return {width, height};
+    }
+    // Even sizes keep 4:2:0 textures free of a half chroma sample.
+    auto scaled = [scale](int size) { return std::max(2, static_cast<int>(std::lround(size * scale)) & ~1); };
+    return {std::min(width, scaled(width)), std::min(height, scaled(height))};
+}
+
+int VideoRenderer::lowres_for(int coded_width, int coded_height) const {
+    if (!settings_.decoder_lowres || applied_output_width_ <= 0 || applied_output_height_ <= 0) {
+        return 0;
+    }
+    // Each lowres step halves the decoded size; stop before it would drop below the output.
+    int lowres = 0;
+    while (lowres < 3 && (coded_width >> (lowres + 1)) >= applied_output_width_ && (coded_height >> (lowres + 1)) >= applied_output_height_) {
+        ++lowres;
+    }
+    return lowres;
+}
+
+VideoRenderer::UploadPath VideoRenderer::choose_upload_path(AVPixelFormat format) {
+    switch (format) {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+        return UploadPath::Planar;
+    case AV_PIX_FMT_NV12:
+    case AV_PIX_FMT_NV21:
+        return UploadPath::SemiPlanar;
+    default:
+        break;
+    }
+    if (pixel_pack::can_pack_to_nv12(format)) {
+        return UploadPath::PackSemiPlanar;
+    }
+    if (pixel_pack::can_pack_to_yuv420p(format)) {
+        return UploadPath::PackPlanar;
+    }
+    return UploadPath::Convert;
+}
+
+void VideoRenderer::allocate_converted(int width, int height, AVPixelFormat format) {
+    converted_ = FramePtr(av_frame_alloc());
+    if (!converted_) {
+        throw std::runtime_error("Failed to allocate conversion frame");
+    }
+    converted_->width = width;
+    converted_->height = height;
+    converted_->format = format;
+    if (av_frame_get_buffer(converted_.get(), 0) < 0) {
+        converted_.reset();
+        throw std::runtime_error("Failed to allocate conversion buffer");
+    }
+}
+
+void VideoRenderer::record_conversion(std::chrono::steady_clock::time_point start) {
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    conversion_stats_.last_ms = elapsed_ms;
+    conversion_stats_.average_ms = conversion_stats_.frames == 0
+        ? elapsed_ms
+        : conversion_stats_.average_ms + conversion_average_weight * (elapsed_ms - conversion_stats_.average_ms);
+    ++conversion_stats_.frames;
+}
+
+void VideoRenderer::ensure_scaler(int width, int height, AVPixelFormat format) {
+    const int threads = conversion_threads(height);
+    if (sws_ && threads == sws_threads_) {
+        return;
+    }
+    if (sws_) {
+        sws_freeContext(sws_);
+    }
+    // The threads option is only available through the AVOptions API, not sws_getContext.
+    sws_ = sws_alloc_context();
+    if (!sws_) {
+        throw std::runtime_error("Failed to acquire swscale context");
+    }
+    av_opt_set_int(sws_, "srcw", width, 0);
+    av_opt_set_int(sws_, "srch", height, 0);
+    av_opt_set_int(sws_, "src_format", format, 0);
+    av_opt_set_int(sws_, "dstw", texture_width_, 0);
+    av_opt_set_int(sws_, "dsth", texture_height_, 0);
+    av_opt_set_int(sws_, "dst_format", scale_format_, 0);
+    // Area averaging avoids aliasing once more than every other source pixel is dropped.
+    const bool large_reduction = texture_width_ * 2 < width || texture_height_ * 2 < height;
+    av_opt_set_int(sws_, "sws_flags", large_reduction ? SWS_AREA : SWS_BILINEAR, 0);
+    av_opt_set_int(sws_, "threads", threads, 0);
+    if (sws_init_context(sws_, nullptr, nullptr) < 0) {
+        sws_freeContext(sws_);
+        sws_ = nullptr;
+        throw std::runtime_error("Failed to initialise swscale context");
+    }
+    sws_threads_ = threads;
+    sws_colorspace_ = AVCOL_SPC_UNSPECIFIED;
+    conversion_stats_ = {};
+    conversion_stats_.threads = threads;
+    utils::get_logger()->debug("Converting {}x{} frames with {} swscale thread(s)", width, height, threads);
+}
+
+void VideoRenderer::apply_scaler_colorspace(const AVFrame* frame) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+    const bool rgb_source = desc && (desc->flags & AV_PIX_FMT_FLAG_RGB);
+    const AVColorSpace colorspace = resolve_colorspace(frame->colorspace, frame_height_);
+    const bool source_full = full_range(frame);
+    // 4:2:0 staged for ColorConverter keeps a YUV source's range, and RGB sources are
+    // staged as limited range. SDL reads its YUV textures as limited range, so unadjusted
+    // output always is.
+    const bool staged_full = adjusting_ && source_full && !rgb_source;
+    if (colorspace != sws_colorspace_ || source_full != sws_full_range_) {
+        // SWS_CS_* share AVColorSpace's values. A YUV destination gets the same matrix, so
+        // swscale only rescales; an RGB source is converted into it.
+        const int* coefficients = sws_getCoefficients(colorspace);
+        if (sws_setColorspaceDetails(sws_, coefficients, source_full ? 1 : 0, coefficients, staged_full ? 1 : 0, 0, 1 << 16, 1 << 16) < 0) {
+            utils::get_logger()->warn("swscale kept its default colourspace for {}", av_color_space_name(colorspace));
         }
+        sws_colorspace_ = colorspace;
+        sws_full_range_ = source_full;
+    }
+    if (adjusting_ && converted_) {
+        converted_->colorspace = colorspace;
+        converted_->color_range = staged_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+    }
+}
+
+int VideoRenderer::conversion_threads(int height) const {
+    auto it = settings_.conversion_threads.upper_bound(height);
+    if (it == settings_.conversion_threads.begin()) {
+        return 1;
     }
+    return std::max(1, std::prev(it)->second);
 }
 
 } // namespace raha::core
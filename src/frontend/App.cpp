@@ -10,11 +10,9 @@ extern "C" {
 }
 
 #include <algorithm>
-#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <filesystem>
-#include <thread>
 
 namespace raha::frontend {
 
@@ -25,6 +23,9 @@ std::filesystem::path config_path() {
     return dir / "config.json";
 }
 
+// The title shows the playback position, so it is refreshed at least this often while playing.
+constexpr double ui_refresh_interval = 0.25;
+
 } // namespace
 
 App::App() : playback_controller_(std::make_unique<raha::core::PlaybackController>(player_)),
@@ -70,6 +71,8 @@ bool App::initialize(int width, int height, const std::string& title) {
 
     if (!library_db_.open(config_.database_path)) {
         raha::utils::get_logger()->warn("Failed to open media library database");
+    } else {
+        player_.set_library(&library_db_);
     }
 
     running_ = true;
@@ -81,6 +84,7 @@ void App::shutdown() {
     running_ = false;
     persist_state();
     player_.shutdown();
+    player_.set_library(nullptr);
     library_db_.close();
     if (renderer_) {
         SDL_DestroyRenderer(renderer_);
@@ -97,11 +101,16 @@ void App::shutdown() {
 }
 
 void App::run() {
-    using namespace std::chrono_literals;
     while (running_) {
+        // Sleep until input, a decoder wakeup or the player's next deadline; with nothing
+        // playing that is the next event.
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        const int timeout = wait_timeout_ms();
+        if (timeout < 0 ? SDL_WaitEvent(&event) : SDL_WaitEventTimeout(&event, timeout)) {
             handle_event(event);
+            while (SDL_PollEvent(&event)) {
+                handle_event(event);
+            }
         }
         player_.update();
         config_.last_position_seconds = player_.current_time();
@@ -111,9 +120,19 @@ void App::run() {
         player_.present();
         render_ui();
         SDL_RenderPresent(renderer_);
+        player_.frame_presented();
+    }
+}
 
-        std::this_thread::sleep_for(10ms);
+int App::wait_timeout_ms() const {
+    std::optional<double> wait = player_.next_wakeup();
+    if (player_.state() == raha::core::PlayerState::Playing) {
+        wait = std::min(wait.value_or(ui_refresh_interval), ui_refresh_interval);
     }
+    if (!wait) {
+        return -1;
+    }
+    return static_cast<int>(std::ceil(*wait * 1000.0));
 }
 
 bool App::open_media(const std::string& uri) {
@@ -182,6 +201,16 @@ void App::handle_event(const SDL_Event& event) {
             break;
         }
         break;
+    case SDL_WINDOWEVENT:
+        if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            // Window coordinates differ from pixels on high-DPI displays.
+            int width = 0;
+            int height = 0;
+            if (SDL_GetRendererOutputSize(renderer_, &width, &height) == 0) {
+                player_.resize(width, height);
+            }
+        }
+        break;
     case SDL_DROPFILE:
         if (event.drop.file) {
             open_media(event.drop.file);
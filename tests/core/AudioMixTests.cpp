@@ -0,0 +1,87 @@
+#include "raha/core/AudioMix.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using raha::core::AudioKernel;
+
+namespace {
+std::vector<float> ramp_input(std::size_t count, float offset) {
+    std::vector<float> samples(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        samples[i] = offset + 0.001F * static_cast<float>(i % 997);
+    }
+    return samples;
+}
+
+} // namespace
+
+TEST(AudioMixTests, BalanceAttenuatesOnlyTheFrontPair) {
+    auto centre = raha::core::channel_gains(0.5F, 0.0F, false);
+    EXPECT_FLOAT_EQ(centre[0], 0.5F);
+    EXPECT_FLOAT_EQ(centre[1], 0.5F);
+    auto left = raha::core::channel_gains(1.0F, -0.5F, false);
+    EXPECT_FLOAT_EQ(left[0], 1.0F);
+    EXPECT_FLOAT_EQ(left[1], 0.5F);
+    EXPECT_FLOAT_EQ(left[2], 1.0F);
+    auto muted = raha::core::channel_gains(1.0F, 0.0F, true);
+    EXPECT_FALSE(raha::core::unity_gains(muted, 2));
+    EXPECT_FLOAT_EQ(muted[1], 0.0F);
+    EXPECT_TRUE(raha::core::unity_gains(raha::core::channel_gains(1.0F, 0.0F, false), 6));
+}
+
+TEST(AudioMixTests, InterleavesPlanarInputAlongTheRamp) {
+    auto mix = raha::core::mix_function(AudioKernel::Scalar);
+    const std::vector<float> left {1, 1, 1, 1};
+    const std::vector<float> right {2, 2, 2, 2};
+    const float* inputs[] = {left.data(), right.data()};
+    raha::core::ChannelGains start;
+    start.fill(1.0F);
+    raha::core::ChannelGains end;
+    end.fill(1.0F);
+    end[0] = 0.0F;
+    std::vector<float> out(8);
+    mix(inputs, 1, 2, 4, start, end, out.data());
+    EXPECT_EQ(out, (std::vector<float> {1, 2, 0.75F, 2, 0.5F, 2, 0.25F, 2}));
+}
+
+TEST(AudioMixTests, KernelsProduceIdenticalOutput) {
+    auto reference = raha::core::mix_function(AudioKernel::Scalar);
+    auto kernel = raha::core::mix_function(raha::core::detect_audio_kernel());
+    ASSERT_NE(kernel, nullptr);
+    auto start = raha::core::channel_gains(0.8F, -0.3F, false);
+    auto end = raha::core::channel_gains(0.2F, 0.4F, false);
+    // Odd frame counts exercise the scalar tails.
+    for (int channels : {1, 2, 6}) {
+        for (std::size_t frames : {1U, 7U, 1023U}) {
+            std::vector<std::vector<float>> planes;
+            std::vector<const float*> inputs;
+            for (int c = 0; c < channels; ++c) {
+                planes.push_back(ramp_input(frames, static_cast<float>(c) * 0.1F - 0.3F));
+            }
+            for (const auto& plane : planes) {
+                inputs.push_back(plane.data());
+            }
+            std::vector<float> expected(frames * channels);
+            std::vector<float> actual(frames * channels);
+            reference(inputs.data(), 1, channels, frames, start, end, expected.data());
+            kernel(inputs.data(), 1, channels, frames, start, end, actual.data());
+            EXPECT_EQ(actual, expected) << channels << " planar, " << frames;
+
+            // Interleaved, in place.
+            std::vector<float> interleaved(frames * channels);
+            for (std::size_t i = 0; i < frames; ++i) {
+                for (int c = 0; c < channels; ++c) {
+                    interleaved[i * channels + c] = planes[c][i];
+                }
+            }
+            std::vector<const float*> packed;
+            for (int c = 0; c < channels; ++c) {
+                packed.push_back(interleaved.data() + c);
+            }
+            kernel(packed.data(), channels, channels, frames, start, end, interleaved.data());
+            EXPECT_EQ(interleaved, expected) << channels << " interleaved, " << frames;
+        }
+    }
+}
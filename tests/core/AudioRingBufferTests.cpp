@@ -0,0 +1,53 @@
+#include "raha/core/AudioRingBuffer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+TEST(AudioRingBufferTests, WrapsAroundAndReportsShortTransfers) {
+    raha::core::AudioRingBuffer ring(6);
+    ASSERT_EQ(ring.capacity(), 8U);
+
+    std::vector<float> input {1, 2, 3, 4, 5, 6};
+    std::vector<float> output(8, 0.0F);
+    EXPECT_EQ(ring.write(input.data(), 6), 6U);
+    EXPECT_EQ(ring.read(output.data(), 4), 4U);
+    // Six more only fit partly, and they cross the end of the storage.
+    EXPECT_EQ(ring.write(input.data(), 6), 6U);
+    EXPECT_EQ(ring.write(input.data(), 6), 0U);
+    EXPECT_EQ(ring.size(), 8U);
+    EXPECT_EQ(ring.read(output.data(), 8), 8U);
+    EXPECT_EQ(output, (std::vector<float> {5, 6, 1, 2, 3, 4, 5, 6}));
+    EXPECT_EQ(ring.read(output.data(), 1), 0U);
+}
+
+TEST(AudioRingBufferTests, PreservesOrderAcrossThreads) {
+    raha::core::AudioRingBuffer ring(1024);
+    constexpr int total = 200000;
+    std::thread producer([&ring] {
+        std::vector<float> chunk(37);
+        int next = 0;
+        while (next < total) {
+            const int count = std::min<int>(static_cast<int>(chunk.size()), total - next);
+            for (int i = 0; i < count; ++i) {
+                chunk[static_cast<std::size_t>(i)] = static_cast<float>(next + i);
+            }
+            next += static_cast<int>(ring.write(chunk.data(), static_cast<std::size_t>(count)));
+        }
+    });
+
+    std::vector<float> chunk(53);
+    int expected = 0;
+    bool ordered = true;
+    while (expected < total) {
+        const std::size_t count = ring.read(chunk.data(), chunk.size());
+        for (std::size_t i = 0; i < count; ++i) {
+            ordered &= chunk[i] == static_cast<float>(expected++);
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(ring.size(), 0U);
+}
@@ -0,0 +1,133 @@
+#include "raha/core/ColorConvert.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using raha::core::ColorKernel;
+
+namespace {
+struct RowInput {
+    raha::core::ColorLuts luts;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> u;
+    std::vector<uint8_t> v;
+};
+
+// Table entries and coefficients span the whole int16 range so the saturating paths are
+// exercised too.
+RowInput random_row(int width, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> wide(-32768, 32767);
+    std::uniform_int_distribution<int> typical(-4096, 20480);
+    std::uniform_int_distribution<int> byte(0, 255);
+    RowInput row;
+    for (int i = 0; i < 256; ++i) {
+        row.luts.y[static_cast<std::size_t>(i)] = i % 5 == 0 ? wide(rng) : typical(rng);
+    }
+    const bool extreme = seed % 2 == 0;
+    auto coefficient = [&] { return static_cast<int16_t>(extreme ? wide(rng) : typical(rng) / 2); };
+    row.luts.rv = coefficient();
+    row.luts.gu = coefficient();
+    row.luts.gv = coefficient();
+    row.luts.bu = coefficient();
+    for (int i = 0; i < width; ++i) {
+        row.y.push_back(static_cast<uint8_t>(byte(rng)));
+    }
+    for (int i = 0; i < (width + 1) / 2; ++i) {
+        row.u.push_back(static_cast<uint8_t>(byte(rng)));
+        row.v.push_back(static_cast<uint8_t>(byte(rng)));
+    }
+    return row;
+}
+
+void expect_matches_scalar(ColorKernel kernel) {
+    auto row_function = raha::core::color_row_function(kernel);
+    if (!row_function) {
+        GTEST_SKIP() << raha::core::to_string(kernel) << " kernel unavailable";
+    }
+    auto scalar = raha::core::color_row_function(ColorKernel::Scalar);
+    for (int width : {1, 7, 16, 31, 64, 1923, 1924}) {
+        RowInput row = random_row(width, static_cast<unsigned>(width));
+        std::vector<uint8_t> expected(static_cast<std::size_t>(width) * 4);
+        std::vector<uint8_t> actual(expected.size());
+        scalar(row.luts, row.y.data(), row.u.data(), row.v.data(), expected.data(), width);
+        row_function(row.luts, row.y.data(), row.u.data(), row.v.data(), actual.data(), width);
+        EXPECT_EQ(actual, expected) << "width " << width;
+    }
+}
+
+std::vector<uint8_t> convert_flat(uint8_t y, AVColorRange range, const raha::core::VideoAdjustments& adjustments) {
+    constexpr int width = 4;
+    constexpr int height = 2;
+    std::vector<uint8_t> luma(width * height, y);
+    std::vector<uint8_t> chroma(width / 2, 128);
+    AVFrame frame {};
+    frame.width = width;
+    frame.height = height;
+    frame.format = AV_PIX_FMT_YUV420P;
+    frame.data[0] = luma.data();
+    frame.data[1] = chroma.data();
+    frame.data[2] = chroma.data();
+    frame.linesize[0] = width;
+    frame.linesize[1] = width / 2;
+    frame.linesize[2] = width / 2;
+
+    raha::core::ColorConverter converter;
+    converter.configure(adjustments, AVCOL_SPC_BT709, range);
+    std::vector<uint8_t> out(width * height * 4);
+    EXPECT_TRUE(converter.convert(&frame, out.data(), width * 4));
+    return out;
+}
+
+} // namespace
+
+TEST(ColorConvertTests, Sse2MatchesScalar) {
+    expect_matches_scalar(ColorKernel::Sse2);
+}
+
+TEST(ColorConvertTests, Avx2MatchesScalar) {
+    expect_matches_scalar(ColorKernel::Avx2);
+}
+
+TEST(ColorConvertTests, ExpandsLimitedAndFullRange) {
+    raha::core::VideoAdjustments identity;
+    auto black = convert_flat(16, AVCOL_RANGE_MPEG, identity);
+    auto white = convert_flat(235, AVCOL_RANGE_MPEG, identity);
+    auto full_white = convert_flat(255, AVCOL_RANGE_JPEG, identity);
+    for (std::size_t i = 0; i < black.size(); ++i) {
+        const uint8_t opaque_or = (i % 4 == 3) ? 255 : 0;
+        EXPECT_EQ(black[i], opaque_or);
+        EXPECT_EQ(white[i], 255);
+        EXPECT_EQ(full_white[i], 255);
+    }
+}
+
+TEST(ColorConvertTests, AppliesAdjustmentsToLuma) {
+    raha::core::VideoAdjustments brighter;
+    brighter.brightness = 0.25F;
+    raha::core::VideoAdjustments darker_gamma;
+    darker_gamma.gamma = -1.0F;
+    EXPECT_TRUE(raha::core::adjustments_active(brighter));
+    EXPECT_FALSE(raha::core::adjustments_active(raha::core::VideoAdjustments {}));
+
+    auto neutral = convert_flat(128, AVCOL_RANGE_JPEG, {});
+    auto lifted = convert_flat(128, AVCOL_RANGE_JPEG, brighter);
+    auto lowered = convert_flat(128, AVCOL_RANGE_JPEG, darker_gamma);
+    EXPECT_EQ(neutral[0], 128);
+    EXPECT_EQ(lifted[0], 192);
+    EXPECT_LT(lowered[0], neutral[0]);
+    EXPECT_EQ(lifted[0], lifted[1]);
+    EXPECT_EQ(lifted[1], lifted[2]);
+}
+
+TEST(ColorConvertTests, PrefersTaggedColorspaceOverHeight) {
+    using raha::core::resolve_colorspace;
+    EXPECT_EQ(resolve_colorspace(AVCOL_SPC_BT709, 480), AVCOL_SPC_BT709);
+    EXPECT_EQ(resolve_colorspace(AVCOL_SPC_BT470BG, 1080), AVCOL_SPC_BT470BG);
+    EXPECT_EQ(resolve_colorspace(AVCOL_SPC_BT2020_NCL, 2160), AVCOL_SPC_BT2020_NCL);
+    EXPECT_EQ(resolve_colorspace(AVCOL_SPC_UNSPECIFIED, 1080), AVCOL_SPC_BT709);
+    EXPECT_EQ(resolve_colorspace(AVCOL_SPC_UNSPECIFIED, 576), AVCOL_SPC_SMPTE170M);
+    EXPECT_EQ(resolve_colorspace(AVCOL_SPC_RGB, 576), AVCOL_SPC_SMPTE170M);
+}
@@ -0,0 +1,66 @@
+#include "raha/core/DecodeQualityController.hpp"
+
+#include <gtest/gtest.h>
+
+using raha::core::DecodeQuality;
+
+namespace {
+raha::core::DecodeQualityTuning fast_tuning() {
+    raha::core::DecodeQualityTuning tuning;
+    tuning.average_weight = 0.5;
+    tuning.degrade_samples = 3;
+    tuning.recover_samples = 6;
+    tuning.settle_samples = 2;
+    return tuning;
+}
+
+DecodeQuality feed(raha::core::DecodeQualityController& controller, double seconds, int count) {
+    for (int i = 0; i < count; ++i) {
+        controller.record(seconds);
+    }
+    return controller.level();
+}
+
+} // namespace
+
+TEST(DecodeQualityControllerTests, DegradesOneStepAtATime) {
+    raha::core::DecodeQualityController controller(fast_tuning());
+    controller.reset(0.04, true);
+    EXPECT_EQ(feed(controller, 0.02, 50), DecodeQuality::Full);
+
+    controller.reset(0.04, true);
+    EXPECT_EQ(feed(controller, 0.08, 4), DecodeQuality::SkipLoopFilter);
+    EXPECT_EQ(feed(controller, 0.08, 4), DecodeQuality::SkipNonRef);
+    EXPECT_EQ(feed(controller, 0.08, 4), DecodeQuality::LowRes);
+    EXPECT_EQ(feed(controller, 0.08, 4), DecodeQuality::KeyframeOnly);
+    EXPECT_EQ(feed(controller, 0.08, 40), DecodeQuality::KeyframeOnly);
+}
+
+TEST(DecodeQualityControllerTests, SkipsLowResWhenUnsupported) {
+    raha::core::DecodeQualityController controller(fast_tuning());
+    controller.reset(0.04, false);
+    EXPECT_EQ(feed(controller, 0.08, 12), DecodeQuality::KeyframeOnly);
+    EXPECT_EQ(feed(controller, 0.001, 8), DecodeQuality::SkipNonRef);
+}
+
+TEST(DecodeQualityControllerTests, RecoversOnlyWithHeadroom) {
+    raha::core::DecodeQualityController controller(fast_tuning());
+    controller.reset(0.04, true);
+    EXPECT_EQ(feed(controller, 0.08, 4), DecodeQuality::SkipLoopFilter);
+    // Between the recover and degrade thresholds nothing changes.
+    EXPECT_EQ(feed(controller, 0.032, 100), DecodeQuality::SkipLoopFilter);
+    EXPECT_EQ(feed(controller, 0.01, 8), DecodeQuality::Full);
+}
+
+TEST(DecodeQualityControllerTests, DiscardSettingsAccumulate) {
+    auto full = raha::core::discard_settings(DecodeQuality::Full);
+    EXPECT_EQ(full.skip_loop_filter, AVDISCARD_DEFAULT);
+    EXPECT_FALSE(full.lowres);
+
+    auto lowres = raha::core::discard_settings(DecodeQuality::LowRes);
+    EXPECT_EQ(lowres.skip_loop_filter, AVDISCARD_ALL);
+    EXPECT_EQ(lowres.skip_frame, AVDISCARD_NONREF);
+    EXPECT_TRUE(lowres.lowres);
+
+    EXPECT_EQ(raha::core::discard_settings(DecodeQuality::KeyframeOnly).skip_frame, AVDISCARD_NONKEY);
+}
@@ -0,0 +1,58 @@
+#include "raha/core/FramePacer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace {
+constexpr double refresh_60 = 1.0 / 60.0;
+
+} // namespace
+
+TEST(FramePacerTests, EstimatesVsyncFromNoisyPresents) {
+    raha::core::FramePacer pacer;
+    pacer.reset(refresh_60);
+    // The display actually runs at 59.94 Hz and presents return up to 1 ms late.
+    const double actual = 1.0 / 59.94;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> delay(0.0, 0.001);
+    for (int i = 0; i < 2000; ++i) {
+        pacer.record_present(10.0 + i * actual + delay(rng));
+    }
+    EXPECT_NEAR(pacer.refresh_interval(), actual, 0.00002);
+    const double last = 10.0 + 1999 * actual;
+    EXPECT_NEAR(pacer.next_vsync(last + 0.002), last + actual, 0.001);
+}
+
+TEST(FramePacerTests, AssignsFilmFramesToAThreeTwoCadence) {
+    raha::core::FramePacer pacer;
+    pacer.reset(refresh_60);
+    const double frame = 1.0 / 24.0;
+    double shown_pts = -1.0;
+    for (int vsync = 0; vsync < 600; ++vsync) {
+        const double now = vsync * refresh_60;
+        // Presents are issued 5 ms after a vsync; the clock plays from 0 at normal speed.
+        const double issue = now + 0.005;
+        const double display = pacer.display_time(issue, issue, 1.0);
+        const double pts = std::floor(display / frame) * frame;
+        pacer.record_present(now + refresh_60);
+        if (pts != shown_pts) {
+            pacer.record_frame_shown();
+            shown_pts = pts;
+        }
+    }
+    auto stats = pacer.stats();
+    EXPECT_NEAR(stats.mean_display, frame, 0.0005);
+    // An ideal 3:2 pattern alternates 50 and 33.3 ms, a standard deviation of 8.3 ms;
+    // random extra repeats would push it higher.
+    EXPECT_NEAR(stats.jitter, refresh_60 / 2.0, 0.0005);
+}
+
+TEST(FramePacerTests, CorrectsOnlyNearWholeVsyncMultiples) {
+    raha::core::FramePacer pacer;
+    pacer.reset(1.0 / 24.0);
+    EXPECT_NEAR(pacer.clock_correction(1001.0 / 24000.0, 0.005), 1.001, 1e-9);
+    pacer.reset(refresh_60);
+    EXPECT_NEAR(pacer.clock_correction(1001.0 / 30000.0, 0.005), 1.001, 1e-9);
+    EXPECT_DOUBLE_EQ(pacer.clock_correction(1.0 / 25.0, 0.005), 1.0);
+}
@@ -0,0 +1,32 @@
+#include "raha/core/FramePool.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(FramePoolTests, RecyclesFrameShells) {
+    raha::core::FramePool pool(4);
+    AVFrame* first_address = nullptr;
+    {
+        auto frame = pool.acquire_frame();
+        first_address = frame.get();
+    }
+    auto frame = pool.acquire_frame();
+    EXPECT_EQ(frame.get(), first_address);
+
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.frame_misses, 1U);
+    EXPECT_EQ(stats.frame_hits, 1U);
+}
+
+TEST(FramePoolTests, RecyclesPacketShellsUpToLimit) {
+    raha::core::FramePool pool(1);
+    {
+        auto first = pool.acquire_packet();
+        auto second = pool.acquire_packet();
+    }
+    auto again = pool.acquire_packet();
+    auto fresh = pool.acquire_packet();
+
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.packet_misses, 3U);
+    EXPECT_EQ(stats.packet_hits, 1U);
+}
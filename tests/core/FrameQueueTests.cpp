@@ -0,0 +1,46 @@
+#include "raha/core/FrameQueue.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+raha::core::FramePtr make_frame(int64_t pts) {
+    raha::core::FramePtr frame(av_frame_alloc());
+    frame->pts = pts;
+    return frame;
+}
+
+} // namespace
+
+TEST(FrameQueueTests, DropsFramesFromStaleSerial) {
+    raha::core::FrameQueue queue(4);
+    queue.push(make_frame(1), 0);
+    queue.flush(1);
+    queue.push(make_frame(2), 0);
+    queue.push(make_frame(3), 1);
+    EXPECT_EQ(queue.size(), 1U);
+    auto frame = queue.try_pop();
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->pts, 3);
+    EXPECT_FALSE(queue.try_pop());
+}
+
+TEST(FrameQueueTests, FlushReleasesBlockedProducer) {
+    raha::core::FrameQueue queue(1);
+    queue.push(make_frame(1), 0);
+    std::thread producer([&queue] { queue.push(make_frame(2), 0); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.flush(1);
+    producer.join();
+    EXPECT_EQ(queue.size(), 0U);
+}
+
+TEST(FrameQueueTests, StopReleasesBlockedConsumer) {
+    raha::core::FrameQueue queue(2);
+    std::thread consumer([&queue] { EXPECT_FALSE(queue.pop()); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.stop();
+    consumer.join();
+}
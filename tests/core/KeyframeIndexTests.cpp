@@ -0,0 +1,54 @@
+#include "raha/core/KeyframeIndex.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(KeyframeIndexTests, EncodeDecodeRoundTrip) {
+    raha::core::KeyframeIndex index(0, {1, 90000});
+    index.add(-3003, 564);
+    index.add(90090, 1'250'000);
+    index.add(180180, 1'100'000);
+    index.add(9'000'000'000LL, 4'000'000'000LL);
+    index.finish();
+
+    auto encoded = index.encode();
+    auto decoded = raha::core::KeyframeIndex::decode(encoded, 0, {1, 90000});
+    ASSERT_TRUE(decoded.has_value());
+    ASSERT_EQ(decoded->size(), index.size());
+    for (std::size_t i = 0; i < index.size(); ++i) {
+        EXPECT_EQ(decoded->entries()[i].pts, index.entries()[i].pts);
+        EXPECT_EQ(decoded->entries()[i].pos, index.entries()[i].pos);
+    }
+}
+
+TEST(KeyframeIndexTests, DeltaEncodingIsCompact) {
+    raha::core::KeyframeIndex index(0, {1, 1000});
+    for (int i = 0; i < 1000; ++i) {
+        index.add(i * 2000LL, i * 400'000LL);
+    }
+    index.finish();
+    EXPECT_LT(index.encode().size(), 6000U);
+}
+
+TEST(KeyframeIndexTests, FindReturnsPrecedingKeyframe) {
+    raha::core::KeyframeIndex index(0, {1, 1000});
+    index.add(4000, 400);
+    index.add(0, 0);
+    index.add(2000, 200);
+    index.finish();
+
+    EXPECT_EQ(index.find(-10)->pts, 0);
+    EXPECT_EQ(index.find(1999)->pos, 0);
+    EXPECT_EQ(index.find(2000)->pos, 200);
+    EXPECT_EQ(index.find(100000)->pos, 400);
+    EXPECT_FALSE(raha::core::KeyframeIndex().find(0).has_value());
+}
+
+TEST(KeyframeIndexTests, DecodeRejectsTruncatedData) {
+    raha::core::KeyframeIndex index(0, {1, 1000});
+    index.add(0, 0);
+    index.add(1000, 300);
+    auto encoded = index.encode();
+    encoded.pop_back();
+    EXPECT_FALSE(raha::core::KeyframeIndex::decode(encoded, 0, {1, 1000}).has_value());
+    EXPECT_FALSE(raha::core::KeyframeIndex::decode({}, 0, {1, 1000}).has_value());
+}
@@ -0,0 +1,64 @@
+#include "raha/core/MasterClock.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using raha::core::SyncMode;
+
+TEST(MasterClockTests, AudioFallsBackToVideoWithoutAudio) {
+    raha::core::MasterClock clock;
+    EXPECT_EQ(clock.effective_mode(true), SyncMode::Audio);
+    EXPECT_EQ(clock.effective_mode(false), SyncMode::Video);
+    clock.set_mode(SyncMode::External);
+    EXPECT_EQ(clock.effective_mode(true), SyncMode::External);
+}
+
+TEST(MasterClockTests, SlewsAnHourOfDriftWithoutJumps) {
+    raha::core::MasterClock clock;
+    // The follower runs 200 ppm slow and is polled at 30 Hz for an hour.
+    const double step = 1.0 / 30.0;
+    double master = 0.0;
+    double follower = 0.0;
+    double rate = 1.0;
+    double worst = 0.0;
+    for (int i = 0; i < 30 * 3600; ++i) {
+        master += step;
+        follower += step * 0.9998 * rate;
+        auto correction = clock.update(master, follower);
+        ASSERT_FALSE(correction.jump);
+        rate = correction.rate;
+        if (i > 30 * 60) {
+            worst = std::max(worst, std::abs(master - follower));
+        }
+    }
+    EXPECT_LT(worst, 0.002);
+    EXPECT_EQ(clock.stats(true).resyncs, 0U);
+}
+
+TEST(MasterClockTests, JumpsOverLargeDriftAfterWarmup) {
+    raha::core::SyncTuning tuning;
+    tuning.warmup_samples = 4;
+    raha::core::MasterClock clock(tuning);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FALSE(clock.update(10.5, 10.0).jump);
+    }
+    auto correction = clock.update(10.5, 10.0);
+    ASSERT_TRUE(correction.jump);
+    EXPECT_DOUBLE_EQ(*correction.jump, 0.5);
+    EXPECT_EQ(clock.stats(true).resyncs, 1U);
+    EXPECT_DOUBLE_EQ(clock.drift(), 0.0);
+}
+
+TEST(MasterClockTests, LimitsTheRateCorrection) {
+    raha::core::MasterClock clock;
+    raha::core::SyncCorrection correction;
+    for (int i = 0; i < 20; ++i) {
+        correction = clock.update(1.05, 1.0);
+    }
+    EXPECT_DOUBLE_EQ(correction.rate, 1.005);
+    for (int i = 0; i < 200; ++i) {
+        correction = clock.update(1.0, 1.05);
+    }
+    EXPECT_DOUBLE_EQ(correction.rate, 0.995);
+}
@@ -0,0 +1,67 @@
+#include "raha/core/PacketQueue.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+raha::core::PacketPtr make_packet(int size, int64_t duration) {
+    raha::core::PacketPtr packet(av_packet_alloc());
+    packet->size = size;
+    packet->duration = duration;
+    return packet;
+}
+
+} // namespace
+
+TEST(PacketQueueTests, TracksBytesAndDuration) {
+    raha::core::PacketQueue queue({1024 * 1024, 1.0, 2});
+    queue.set_time_base({1, 1000});
+    for (int i = 0; i < 3; ++i) {
+        queue.push(make_packet(100, 400));
+    }
+    EXPECT_EQ(queue.size(), 3U);
+    EXPECT_DOUBLE_EQ(queue.duration_seconds(), 1.2);
+    EXPECT_TRUE(queue.has_enough());
+
+    auto packet = queue.pop(false);
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_DOUBLE_EQ(queue.duration_seconds(), 0.8);
+    EXPECT_FALSE(queue.has_enough());
+}
+
+TEST(PacketQueueTests, ByteLimitAloneIsEnough) {
+    raha::core::PacketQueue queue({256, 10.0, 100});
+    queue.push(make_packet(512, 0));
+    EXPECT_TRUE(queue.has_enough());
+}
+
+TEST(PacketQueueTests, DeliversEndOfStreamMarker) {
+    raha::core::PacketQueue queue;
+    EXPECT_FALSE(queue.pop(false).has_value());
+    queue.push(nullptr);
+    auto marker = queue.pop(false);
+    ASSERT_TRUE(marker.has_value());
+    EXPECT_EQ(marker->packet, nullptr);
+}
+
+TEST(PacketQueueTests, FlushStartsNewSerial) {
+    raha::core::PacketQueue queue;
+    queue.push(make_packet(10, 1));
+    int before = queue.serial();
+    queue.flush();
+    queue.push(make_packet(10, 1));
+    auto packet = queue.pop(false);
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->serial, before + 1);
+    EXPECT_EQ(queue.size(), 0U);
+}
+
+TEST(PacketQueueTests, AbortReleasesBlockedConsumer) {
+    raha::core::PacketQueue queue;
+    queue.push(make_packet(10, 1));
+    queue.abort();
+    EXPECT_FALSE(queue.pop(true).has_value());
+    queue.start();
+    queue.flush();
+    EXPECT_EQ(queue.size(), 0U);
+    EXPECT_EQ(queue.bytes(), 0U);
+}
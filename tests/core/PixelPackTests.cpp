@@ -0,0 +1,75 @@
+#include "raha/core/PixelPack.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+uint8_t rounded_average(int a, int b) {
+    return static_cast<uint8_t>((a + b + 1) / 2);
+}
+
+std::vector<uint8_t> pattern(int count, int seed) {
+    std::vector<uint8_t> values(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        values[static_cast<std::size_t>(i)] = static_cast<uint8_t>((i * 37 + seed * 11) & 0xFF);
+    }
+    return values;
+}
+
+} // namespace
+
+TEST(PixelPackTests, NarrowsMsbAndLsbAlignedSamples) {
+    constexpr int count = 37;
+    std::vector<uint16_t> p010(count);
+    std::vector<uint16_t> yuv10(count);
+    for (int i = 0; i < count; ++i) {
+        int value = (i * 29) & 0x3FF;
+        p010[static_cast<std::size_t>(i)] = static_cast<uint16_t>(value << 6);
+        yuv10[static_cast<std::size_t>(i)] = static_cast<uint16_t>(value);
+    }
+    std::vector<uint8_t> from_p010(count);
+    std::vector<uint8_t> from_yuv10(count);
+    raha::core::pixel_pack::narrow_row(p010.data(), from_p010.data(), count, 8);
+    raha::core::pixel_pack::narrow_row(yuv10.data(), from_yuv10.data(), count, 2);
+    for (int i = 0; i < count; ++i) {
+        uint8_t expected = static_cast<uint8_t>(((i * 29) & 0x3FF) >> 2);
+        EXPECT_EQ(from_p010[static_cast<std::size_t>(i)], expected);
+        EXPECT_EQ(from_yuv10[static_cast<std::size_t>(i)], expected);
+    }
+}
+
+TEST(PixelPackTests, AveragesRows) {
+    constexpr int count = 45;
+    auto row0 = pattern(count, 1);
+    auto row1 = pattern(count, 7);
+    std::vector<uint8_t> out(count);
+    raha::core::pixel_pack::average_rows(row0.data(), row1.data(), out.data(), count);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        EXPECT_EQ(out[i], rounded_average(row0[i], row1[i]));
+    }
+}
+
+TEST(PixelPackTests, DownsamplesOddWidthMatchingReference) {
+    constexpr int src_count = 71;
+    auto row0 = pattern(src_count, 3);
+    auto row1 = pattern(src_count, 5);
+    std::vector<uint8_t> out((src_count + 1) / 2);
+    raha::core::pixel_pack::downsample_2x2(row0.data(), row1.data(), out.data(), src_count);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        std::size_t left = 2 * i;
+        std::size_t right = std::min(left + 1, static_cast<std::size_t>(src_count - 1));
+        uint8_t expected = rounded_average(rounded_average(row0[left], row1[left]), rounded_average(row0[right], row1[right]));
+        EXPECT_EQ(out[i], expected) << "column " << i;
+    }
+}
+
+TEST(PixelPackTests, LeavesFullRangeFormatsToSwscale) {
+    using raha::core::pixel_pack::can_pack_to_yuv420p;
+    EXPECT_TRUE(can_pack_to_yuv420p(AV_PIX_FMT_YUV422P));
+    EXPECT_TRUE(can_pack_to_yuv420p(AV_PIX_FMT_YUV444P));
+    EXPECT_TRUE(can_pack_to_yuv420p(AV_PIX_FMT_YUV420P10LE));
+    EXPECT_FALSE(can_pack_to_yuv420p(AV_PIX_FMT_YUVJ422P));
+    EXPECT_FALSE(can_pack_to_yuv420p(AV_PIX_FMT_YUVJ444P));
+    EXPECT_FALSE(can_pack_to_yuv420p(AV_PIX_FMT_YUVJ440P));
+}
@@ -0,0 +1,62 @@
+#include "raha/core/ReverseDecoder.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+raha::core::FramePtr make_frame(int64_t pts, int width = 64, int height = 64) {
+    raha::core::FramePtr frame(av_frame_alloc());
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    EXPECT_EQ(av_frame_get_buffer(frame.get(), 0), 0);
+    frame->pts = pts;
+    return frame;
+}
+
+} // namespace
+
+TEST(ReverseDecoderTests, GopSortsFramesIntoPresentationOrder) {
+    raha::core::ReverseGop gop;
+    // Decode order of I P B B.
+    for (int64_t pts : {0, 3, 1, 2}) {
+        ASSERT_TRUE(gop.add(make_frame(pts), 1U << 30));
+    }
+    gop.finish();
+    ASSERT_EQ(gop.frames.size(), 4U);
+    for (std::size_t i = 0; i < gop.frames.size(); ++i) {
+        EXPECT_EQ(gop.frames[i]->pts, static_cast<int64_t>(i));
+    }
+    EXPECT_FALSE(gop.keyframe_only);
+}
+
+TEST(ReverseDecoderTests, GopOverBudgetKeepsOnlyItsKeyframe) {
+    raha::core::ReverseGop gop;
+    const std::size_t frame_size = raha::core::frame_bytes(make_frame(0).get());
+    ASSERT_GT(frame_size, 0U);
+    const std::size_t budget = frame_size * 3;
+    EXPECT_TRUE(gop.add(make_frame(0), budget));
+    EXPECT_TRUE(gop.add(make_frame(1), budget));
+    EXPECT_TRUE(gop.add(make_frame(2), budget));
+    EXPECT_FALSE(gop.add(make_frame(3), budget));
+    EXPECT_TRUE(gop.keyframe_only);
+    ASSERT_EQ(gop.frames.size(), 1U);
+    EXPECT_EQ(gop.frames.front()->pts, 0);
+    EXPECT_EQ(gop.bytes, frame_size);
+    EXPECT_FALSE(gop.add(make_frame(4), budget));
+}
+
+TEST(ReverseDecoderTests, KeyframeAloneIsKeptEvenOverBudget) {
+    raha::core::ReverseGop gop;
+    EXPECT_TRUE(gop.add(make_frame(0, 256, 256), 1));
+    EXPECT_FALSE(gop.keyframe_only);
+    EXPECT_FALSE(gop.add(make_frame(1), 1));
+    EXPECT_TRUE(gop.keyframe_only);
+}
+
+TEST(ReverseDecoderTests, NothingToReadWithoutAStart) {
+    raha::core::ReverseDecoder decoder;
+    EXPECT_FALSE(decoder.next_frame());
+    EXPECT_FALSE(decoder.active());
+    EXPECT_FALSE(decoder.start("/nonexistent/file.mkv", 0, 10.0, nullptr));
+    EXPECT_FALSE(decoder.active());
+}
@@ -0,0 +1,108 @@
+#include "raha/core/TimeStretcher.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+using raha::core::StretchAlgorithm;
+
+namespace {
+constexpr int sample_rate = 48000;
+
+// Stereo sine of `frequency`, continuing from frame `first`.
+std::vector<float> sine(double frequency, std::size_t first, std::size_t frames) {
+    std::vector<float> samples(frames * 2);
+    for (std::size_t i = 0; i < frames; ++i) {
+        const auto value = static_cast<float>(0.5 * std::sin(2.0 * std::numbers::pi * frequency * static_cast<double>(first + i) / sample_rate));
+        samples[i * 2] = value;
+        samples[i * 2 + 1] = value;
+    }
+    return samples;
+}
+
+std::vector<float> stretch(raha::core::TimeStretcher& stretcher, double frequency, std::size_t seconds) {
+    std::vector<float> result;
+    std::vector<float> chunk;
+    const std::size_t block = 1024;
+    for (std::size_t first = 0; first < seconds * sample_rate; first += block) {
+        auto input = sine(frequency, first, block);
+        stretcher.process(input.data(), block, chunk);
+        result.insert(result.end(), chunk.begin(), chunk.end());
+    }
+    return result;
+}
+
+// Dominant frequency from the rate of upward zero crossings on the left channel.
+double crossing_frequency(const std::vector<float>& samples) {
+    int crossings = 0;
+    for (std::size_t i = 2; i < samples.size(); i += 2) {
+        if (samples[i - 2] < 0.0F && samples[i] >= 0.0F) {
+            ++crossings;
+        }
+    }
+    return crossings * static_cast<double>(sample_rate) / static_cast<double>(samples.size() / 2);
+}
+
+} // namespace
+
+TEST(TimeStretcherTests, PassesThroughAtNormalSpeed) {
+    raha::core::TimeStretcher stretcher;
+    stretcher.configure(sample_rate, 2);
+    auto input = sine(440.0, 0, 4096);
+    std::vector<float> output;
+    EXPECT_EQ(stretcher.process(input.data(), 4096, output), 4096U);
+    EXPECT_EQ(output, input);
+    EXPECT_EQ(stretcher.algorithm(), StretchAlgorithm::Bypass);
+    EXPECT_DOUBLE_EQ(stretcher.buffered_frames(), 0.0);
+}
+
+TEST(TimeStretcherTests, ChangesTempoButNotPitch) {
+    for (double speed : {0.5, 1.5, 2.0, 3.0}) {
+        raha::core::TimeStretcher stretcher;
+        stretcher.configure(sample_rate, 2);
+        stretcher.set_speed(speed);
+        auto output = stretch(stretcher, 440.0, 4);
+        const double produced = static_cast<double>(output.size() / 2) / sample_rate;
+        EXPECT_NEAR(produced, 4.0 / speed, 0.05) << speed;
+        // Plain overlap-add splices with random phase, which adds spurious crossings.
+        if (stretcher.algorithm() == StretchAlgorithm::Wsola) {
+            EXPECT_NEAR(crossing_frequency(output), 440.0, 5.0) << speed;
+        }
+        EXPECT_GT(stretcher.stats().output_seconds, 0.0);
+    }
+}
+
+TEST(TimeStretcherTests, PicksTheCheapAlgorithmAboveTwoTimes) {
+    EXPECT_EQ(raha::core::TimeStretcher::algorithm_for(1.0, 2.0), StretchAlgorithm::Bypass);
+    EXPECT_EQ(raha::core::TimeStretcher::algorithm_for(1.75, 2.0), StretchAlgorithm::Wsola);
+    EXPECT_EQ(raha::core::TimeStretcher::algorithm_for(2.0, 2.0), StretchAlgorithm::Wsola);
+    EXPECT_EQ(raha::core::TimeStretcher::algorithm_for(2.5, 2.0), StretchAlgorithm::Ola);
+}
+
+TEST(TimeStretcherTests, ReturnsToPassThroughWithoutASeam) {
+    raha::core::TimeStretcher stretcher;
+    stretcher.configure(sample_rate, 2);
+    stretcher.set_speed(1.5);
+    std::vector<float> output;
+    std::vector<float> collected;
+    std::size_t first = 0;
+    for (; first < sample_rate; first += 1000) {
+        auto input = sine(440.0, first, 1000);
+        stretcher.process(input.data(), 1000, output);
+        collected.insert(collected.end(), output.begin(), output.end());
+    }
+    stretcher.set_speed(1.0);
+    auto input = sine(440.0, first, 1000);
+    stretcher.process(input.data(), 1000, output);
+    collected.insert(collected.end(), output.begin(), output.end());
+    EXPECT_EQ(stretcher.algorithm(), StretchAlgorithm::Bypass);
+    // The last output frame is the last input frame, and no sample jumps further than a
+    // 440 Hz sine can move between two samples.
+    EXPECT_FLOAT_EQ(collected.back(), input.back());
+    const double max_step = 0.5 * 2.0 * std::numbers::pi * 440.0 / sample_rate * 1.5;
+    for (std::size_t i = 2; i < collected.size(); i += 2) {
+        ASSERT_LT(std::abs(collected[i] - collected[i - 2]), max_step) << i;
+    }
+}
@@ -0,0 +1,44 @@
+#include "raha/core/TrickPlay.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(TrickPlayTests, EngagesAboveThresholdAndAlwaysBeyondDecodedSpeed) {
+    raha::core::TrickPlay trick_play;
+    trick_play.set_threshold(2.0);
+    EXPECT_FALSE(trick_play.engaged(1.0));
+    EXPECT_FALSE(trick_play.engaged(2.0));
+    EXPECT_TRUE(trick_play.engaged(4.0));
+    // A threshold above the decodable maximum still leaves 8x and up to keyframes.
+    trick_play.set_threshold(100.0);
+    EXPECT_FALSE(trick_play.engaged(4.0));
+    EXPECT_TRUE(trick_play.engaged(8.0));
+    EXPECT_TRUE(trick_play.engaged(32.0));
+}
+
+TEST(TrickPlayTests, KeepsDecodingWhilePicturesKeepUp) {
+    raha::core::TrickPlay trick_play;
+    trick_play.reset(0.0);
+    // 16x with a keyframe every two seconds shown on time.
+    for (int i = 1; i <= 100; ++i) {
+        const double now = i * 0.125;
+        const double clock = now * 16.0;
+        trick_play.frame_shown(clock - 1.0);
+        EXPECT_FALSE(trick_play.skip_target(clock, 16.0, now));
+    }
+    EXPECT_EQ(trick_play.stats().skips, 0U);
+}
+
+TEST(TrickPlayTests, SkipsAheadOfTheClockWhenPicturesFallBehind) {
+    raha::core::TrickPlayTuning tuning;
+    raha::core::TrickPlay trick_play(tuning);
+    trick_play.reset(0.0);
+    trick_play.frame_shown(1.0);
+    // At 32x the picture may trail by 16 s of media; this one trails by 19.
+    auto target = trick_play.skip_target(20.0, 32.0, 0.6);
+    ASSERT_TRUE(target);
+    EXPECT_DOUBLE_EQ(*target, 20.0 + tuning.lead_seconds * 32.0);
+    // Still lagging, but the previous skip needs time to show something.
+    EXPECT_FALSE(trick_play.skip_target(50.0, 32.0, 0.7));
+    EXPECT_TRUE(trick_play.skip_target(60.0, 32.0, 1.2));
+    EXPECT_EQ(trick_play.stats().skips, 2U);
+}